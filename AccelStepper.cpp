@@ -4,6 +4,16 @@
 // $Id: AccelStepper.cpp,v 1.24 2020/04/20 00:15:03 mikem Exp mikem $
 
 #include "AccelStepper.h"
+#if defined(ESP32)
+#include "soc/gpio_reg.h"
+#endif
+
+// The resolution of micros() in microseconds, 4us at 16MHz on AVR
+#if defined(ARDUINO_ARCH_AVR)
+#define MICROS_RESOLUTION (64 / (F_CPU / 1000000L))
+#else
+#define MICROS_RESOLUTION 1
+#endif
 
 #if 0
 // Some debugging assistance
@@ -40,13 +50,35 @@ void AccelStepper::move(long relative)
 // returns true if a step occurred
 boolean AccelStepper::runSpeed()
 {
+    // A non blocking step pulse must end before the next step
+    if (!finishStepPulse())
+	return false;
+
     // Dont do anything unless we actually have a step interval
     if (!_stepInterval)
+    {
+	// The next step starts a new move, so can't be late
+	_stepScheduled = false;
 	return false;
+    }
 
     unsigned long time = micros();   
     if (time - _lastStepTime >= _stepInterval)
     {
+	unsigned long late = 0;
+	if (_stepScheduled)
+	{
+	    late = time - _lastStepTime - _stepInterval;
+	    _latenessTotal += late;
+	    if (late > _latenessMax)
+		_latenessMax = late;
+	    _latenessCount++;
+	}
+#if defined(__AVR__)
+	// The home and limit sensor interrupts read the position, so they mustn't see it half updated
+	uint8_t oldSREG = SREG;
+	cli();
+#endif
 	if (_direction == DIRECTION_CW)
 	{
 	    // Clockwise
@@ -57,9 +89,23 @@ boolean AccelStepper::runSpeed()
 	    // Anticlockwise  
 	    _currentPos -= 1;
 	}
+#if defined(__AVR__)
+	SREG = oldSREG;
+#endif
 	step(_currentPos);
 
-	_lastStepTime = time; // Caution: does not account for costs in step()
+	if (_stepScheduled && _maxCatchUp)
+	{
+	    // Time the next step from when this one was due rather than when it happened, so a
+	    // late step doesn't delay the rest of the move, catching up by at most _maxCatchUp
+	    if (late > _maxCatchUp)
+		_lastStepTime = time - _maxCatchUp;
+	    else
+		_lastStepTime += _stepInterval;
+	}
+	else
+	    _lastStepTime = time; // Caution: does not account for costs in step()
+	_stepScheduled = true;
 
 	return true;
     }
@@ -92,14 +138,22 @@ void AccelStepper::setCurrentPosition(long position)
     _n = 0;
     _stepInterval = 0;
     _speed = 0.0;
+    _stepScheduled = false;
 }
 
 // Subclasses can override
 unsigned long AccelStepper::computeNewSpeed()
 {
+    if (scurveRamp())
+	return computeSCurveSpeed();
+
     long distanceTo = distanceToGo(); // +ve is clockwise from curent location
 
-    long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)); // Equation 16
+    long stepsToStop;
+    if (fixedRamp())
+	stepsToStop = fixedStepsToStop();
+    else
+	stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)); // Equation 16
 
     if (distanceTo == 0 && stepsToStop <= 1)
     {
@@ -145,6 +199,45 @@ unsigned long AccelStepper::computeNewSpeed()
 	}
     }
 
+    if (fixedRamp())
+    {
+	// Need to accelerate or decelerate, using integer maths only
+	if (_n == 0)
+	{
+	    // First step from stopped, _speed only tracks the direction and that we are moving
+	    _cnFixed = _c0Fixed;
+	    _direction = (distanceTo > 0) ? DIRECTION_CW : DIRECTION_CCW;
+	    _speed = (_direction == DIRECTION_CW) ? _maxSpeed : -_maxSpeed;
+	}
+	else if (_rampEngine == RAMP_TABLE && rampTableLookup())
+	{
+	    // Subsequent step taken from the precomputed table
+	    if (_cnFixed < _cminFixed)
+		_cnFixed = _cminFixed;
+	}
+	else
+	{
+	    // Subsequent step. Works for accel (n is +_ve) and decel (n is -ve).
+	    // Round the quotient, as truncating it biases long ramps towards slower speeds
+	    unsigned long divisor;
+	    if (_n > 0)
+	    {
+		divisor = ((unsigned long)_n << 2) + 1;
+		_cnFixed -= ((_cnFixed << 1) + (divisor >> 1)) / divisor; // Equation 13
+	    }
+	    else
+	    {
+		divisor = ((unsigned long)-_n << 2) - 1;
+		_cnFixed += ((_cnFixed << 1) + (divisor >> 1)) / divisor; // Equation 13
+	    }
+	    if (_cnFixed < _cminFixed)
+		_cnFixed = _cminFixed;
+	}
+	_n++;
+	_stepInterval = _cnFixed >> 8;
+	return _stepInterval;
+    }
+
     // Need to accelerate or decelerate
     if (_n == 0)
     {
@@ -185,13 +278,23 @@ unsigned long AccelStepper::computeNewSpeed()
 boolean AccelStepper::run()
 {
     if (runSpeed())
+    {
 	computeNewSpeed();
+	// Calculating the new speed usually takes longer than the minimum pulse width
+	finishStepPulse();
+    }
     return _speed != 0.0 || distanceToGo() != 0;
 }
 
 AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4, bool enable)
+    : AccelStepper(stepFunction(interface), interface, pin1, pin2, pin3, pin4, enable)
+{
+}
+
+AccelStepper::AccelStepper(StepFunction function, uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4, bool enable)
 {
     _interface = interface;
+    _stepFunction = function;
     _currentPos = 0;
     _targetPos = 0;
     _speed = 0.0;
@@ -200,6 +303,14 @@ AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_
     _sqrt_twoa = 1.0;
     _stepInterval = 0;
     _minPulseWidth = 1;
+    _nonBlockingPulse = false;
+    _maxCatchUp = 0;
+    _stepScheduled = false;
+    _latenessTotal = 0;
+    _latenessMax = 0;
+    _latenessCount = 0;
+    _pulseActive = false;
+    _pulseStartTime = 0;
     _enablePin = 0xff;
     _lastStepTime = 0;
     _pin[0] = pin1;
@@ -214,10 +325,39 @@ AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_
     _cn = 0.0;
     _cmin = 1.0;
     _direction = DIRECTION_CCW;
+    _rampEngine = RAMP_FLOAT;
+    _c0Fixed = 0;
+    _cnFixed = 0;
+    _cminFixed = 256;
+    _maxStopSteps = 0;
+    _rampTable = 0;
+    _rampTableSize = 0;
+    _rampTableLength = 0;
+    _rampTableStride = 0;
+    _rampTableShift = 0;
+    _jerk = 0.0;
+    _scurvePeak = 0.0;
+    _scurvePeakAccel = 0.0;
+    _scurveRampSteps = 0;
+    _scurveJerkTime = 0.0;
+    _scurveV1 = 0.0;
+    _scurveV2 = 0.0;
+    for (uint8_t segment = 0; segment < 4; segment++)
+    {
+	_scurveSegmentSteps[segment] = 0.0;
+	_scurveSegmentTime[segment] = 0.0;
+    }
+    _scurveTimeIndex = -1;
+    _scurveTime = 0.0;
+    _scurveInterval = 0.0;
+    _scurvePreviousInterval = 0.0;
 
     int i;
     for (i = 0; i < 4; i++)
 	_pinInverted[i] = 0;
+#if defined(ACCELSTEPPER_FAST_OUTPUTS)
+    _fastOutputs = false;
+#endif
     if (enable)
 	enableOutputs();
     // Some reasonable default
@@ -228,6 +368,7 @@ AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_
 AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
 {
     _interface = 0;
+    _stepFunction = &AccelStepper::step0;
     _currentPos = 0;
     _targetPos = 0;
     _speed = 0.0;
@@ -236,6 +377,14 @@ AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
     _sqrt_twoa = 1.0;
     _stepInterval = 0;
     _minPulseWidth = 1;
+    _nonBlockingPulse = false;
+    _maxCatchUp = 0;
+    _stepScheduled = false;
+    _latenessTotal = 0;
+    _latenessMax = 0;
+    _latenessCount = 0;
+    _pulseActive = false;
+    _pulseStartTime = 0;
     _enablePin = 0xff;
     _lastStepTime = 0;
     _pin[0] = 0;
@@ -251,10 +400,39 @@ AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
     _cn = 0.0;
     _cmin = 1.0;
     _direction = DIRECTION_CCW;
+    _rampEngine = RAMP_FLOAT;
+    _c0Fixed = 0;
+    _cnFixed = 0;
+    _cminFixed = 256;
+    _maxStopSteps = 0;
+    _rampTable = 0;
+    _rampTableSize = 0;
+    _rampTableLength = 0;
+    _rampTableStride = 0;
+    _rampTableShift = 0;
+    _jerk = 0.0;
+    _scurvePeak = 0.0;
+    _scurvePeakAccel = 0.0;
+    _scurveRampSteps = 0;
+    _scurveJerkTime = 0.0;
+    _scurveV1 = 0.0;
+    _scurveV2 = 0.0;
+    for (uint8_t segment = 0; segment < 4; segment++)
+    {
+	_scurveSegmentSteps[segment] = 0.0;
+	_scurveSegmentTime[segment] = 0.0;
+    }
+    _scurveTimeIndex = -1;
+    _scurveTime = 0.0;
+    _scurveInterval = 0.0;
+    _scurvePreviousInterval = 0.0;
 
     int i;
     for (i = 0; i < 4; i++)
 	_pinInverted[i] = 0;
+#if defined(ACCELSTEPPER_FAST_OUTPUTS)
+    _fastOutputs = false;
+#endif
     // Some reasonable default
     setAcceleration(1);
     setMaxSpeed(1);
@@ -266,14 +444,9 @@ void AccelStepper::setMaxSpeed(float speed)
        speed = -speed;
     if (_maxSpeed != speed)
     {
-	_maxSpeed = speed;
-	_cmin = 1000000.0 / speed;
-	// Recompute _n from current speed and adjust speed if accelerating or cruising
-	if (_n > 0)
-	{
-	    _n = (long)((_speed * _speed) / (2.0 * _acceleration)); // Equation 16
-	    computeNewSpeed();
-	}
+	RampParameters params;
+	rampParameters(params, speed, _acceleration, _rampTable);
+	applyRampParameters(params);
     }
 }
 
@@ -290,11 +463,73 @@ void AccelStepper::setAcceleration(float acceleration)
       acceleration = -acceleration;
     if (_acceleration != acceleration)
     {
-	// Recompute _n per Equation 17
-	_n = _n * (_acceleration / acceleration);
+	RampParameters params;
+	rampParameters(params, _maxSpeed, acceleration, _rampTable);
+	applyRampParameters(params);
+    }
+}
+
+void AccelStepper::rampParameters(RampParameters& params, float maxSpeed, float acceleration, uint16_t* table)
+{
+    params.maxSpeed = maxSpeed;
+    params.acceleration = acceleration;
+    if (maxSpeed == _maxSpeed)
+    {
+	params.cmin = _cmin;
+	params.cminFixed = _cminFixed;
+    }
+    else
+    {
+	params.cmin = 1000000.0 / maxSpeed;
+	params.cminFixed = (params.cmin < 8388607.0) ? (unsigned long)(params.cmin * 256.0) : 0x7FFFFFFF;
+    }
+    if (acceleration == _acceleration)
+    {
+	params.c0 = _c0;
+	params.c0Fixed = _c0Fixed;
+	params.accelerationRatio = 1.0;
+    }
+    else
+    {
 	// New c0 per Equation 7, with correction per Equation 15
-	_c0 = 0.676 * sqrt(2.0 / acceleration) * 1000000.0; // Equation 15
-	_acceleration = acceleration;
+	params.c0 = 0.676 * sqrt(2.0 / acceleration) * 1000000.0; // Equation 15
+	// Keep the fixed point c0 within 31 bits so Equation 13 cannot overflow
+	params.c0Fixed = (params.c0 < 8388607.0) ? (unsigned long)(params.c0 * 256.0) : 0x7FFFFFFF;
+	params.accelerationRatio = _acceleration / acceleration; // Equation 17
+    }
+    params.stopStepsPerSpeedSquared = 1.0 / (2.0 * acceleration);
+    params.maxStopSteps = (long)((maxSpeed * maxSpeed) / (2.0 * acceleration)); // Equation 16
+    params.rampTable = table;
+    buildRampTable(params);
+}
+
+void AccelStepper::applyRampParameters(const RampParameters& params)
+{
+    boolean speedChanged = params.maxSpeed != _maxSpeed;
+    boolean accelerationChanged = params.acceleration != _acceleration;
+    float currentSpeed = speedChanged ? this->speed() : 0.0;
+    // Recompute _n per Equation 17, RAMP_SCURVE uses the new acceleration from the next move
+    if (accelerationChanged && !scurveRamp())
+	_n = _n * params.accelerationRatio;
+    _maxSpeed = params.maxSpeed;
+    _acceleration = params.acceleration;
+    _c0 = params.c0;
+    _c0Fixed = params.c0Fixed;
+    _cmin = params.cmin;
+    _cminFixed = params.cminFixed;
+    _maxStopSteps = params.maxStopSteps;
+    if (_rampTable && params.rampTable != _rampTable)
+	memcpy(_rampTable, params.rampTable, params.rampTableLength * sizeof(uint16_t));
+    _rampTableLength = params.rampTableLength;
+    _rampTableStride = params.rampTableStride;
+    _rampTableShift = params.rampTableShift;
+    if (accelerationChanged)
+	computeNewSpeed();
+    else if (speedChanged && _n > 0 && !scurveRamp())
+    {
+	// Recompute _n from current speed and adjust speed if accelerating or cruising
+	// RAMP_SCURVE uses the new speed from the next move
+	_n = (long)((currentSpeed * currentSpeed) * params.stopStepsPerSpeedSquared); // Equation 16
 	computeNewSpeed();
     }
 }
@@ -304,6 +539,236 @@ float   AccelStepper::acceleration()
     return _acceleration;
 }
 
+void AccelStepper::setJerk(float jerk)
+{
+    if (jerk <= 0.0)
+	return;
+    _jerk = jerk;
+}
+
+float   AccelStepper::jerk()
+{
+    return _jerk;
+}
+
+boolean AccelStepper::scurveRamp()
+{
+    return _rampEngine == RAMP_SCURVE && _jerk > 0.0;
+}
+
+void AccelStepper::planSCurve(long distance)
+{
+    // Lowest peak speed that reaches full acceleration
+    float fullAccelSpeed = _acceleration * _acceleration / _jerk;
+    // Use maxSpeed if accelerating to it takes no more than half the move, otherwise the
+    // speed that takes exactly half, so accelerating and decelerating meet with 0 acceleration
+    float half = distance / 2.0;
+    float peak = _maxSpeed;
+    float rampSteps = (peak >= fullAccelSpeed) ? peak / 2.0 * (peak / _acceleration + _acceleration / _jerk)
+					       : peak * sqrt(peak / _jerk);
+    if (rampSteps > half)
+    {
+	if (fullAccelSpeed * sqrt(fullAccelSpeed / _jerk) >= half)
+	    peak = pow(_jerk * half * half, 1.0 / 3.0);
+	else
+	    peak = (sqrt(fullAccelSpeed * fullAccelSpeed + 8.0 * _acceleration * half) - fullAccelSpeed) / 2.0;
+	rampSteps = half;
+    }
+    _scurvePeak = peak;
+    _scurvePeakAccel = (peak >= fullAccelSpeed) ? _acceleration : sqrt(peak * _jerk);
+    _scurveRampSteps = (long)rampSteps;
+    // The acceleration rises at the jerk limit to its peak, holds, then falls back to 0 at peak speed
+    _scurveJerkTime = _scurvePeakAccel / _jerk;
+    _scurveV1 = _scurvePeakAccel * _scurveJerkTime / 2.0;
+    _scurveV2 = peak - _scurveV1;
+    float holdTime = (_scurveV2 > _scurveV1) ? (_scurveV2 - _scurveV1) / _scurvePeakAccel : 0.0;
+    _scurveSegmentSteps[1] = _scurvePeakAccel * _scurveJerkTime * _scurveJerkTime / 6.0;
+    _scurveSegmentSteps[2] = _scurveSegmentSteps[1] + holdTime * (_scurveV1 + _scurveV2) / 2.0;
+    _scurveSegmentSteps[3] = _scurveSegmentSteps[2] + _scurveJerkTime * (_scurveV2 + _scurvePeakAccel * _scurveJerkTime / 3.0);
+    _scurveSegmentTime[1] = _scurveJerkTime;
+    _scurveSegmentTime[2] = _scurveJerkTime + holdTime;
+    _scurveSegmentTime[3] = 2.0 * _scurveJerkTime + holdTime;
+    _scurveTimeIndex = -1;
+}
+
+float AccelStepper::scurveTime(long steps)
+{
+    float s = steps;
+    if (s <= _scurveSegmentSteps[1])
+	return pow(6.0 * s / _jerk, 1.0 / 3.0);
+    if (s <= _scurveSegmentSteps[2])
+	return _scurveSegmentTime[1] + 2.0 * (s - _scurveSegmentSteps[1])
+	    / (_scurveV1 + sqrt(_scurveV1 * _scurveV1 + 2.0 * _scurvePeakAccel * (s - _scurveSegmentSteps[1])));
+    if (s < _scurveSegmentSteps[3])
+	return _scurveSegmentTime[2] + scurveSegmentTime(2, _scurveSegmentTime[2], s - _scurveSegmentSteps[2], false, 0.0);
+    return _scurveSegmentTime[3] + (s - _scurveSegmentSteps[3]) / _scurvePeak;
+}
+
+float AccelStepper::scurveSegmentTime(uint8_t segment, float time, float distance, boolean backward, float guess)
+{
+    if (distance <= 0.0)
+	return 0.0;
+    // The speed, acceleration and jerk at time, the distance is a cubic in time within a segment
+    float speed;
+    float accel;
+    float jerk;
+    if (segment == 0)
+    {
+	jerk = _jerk;
+	accel = _jerk * time;
+	speed = accel * time / 2.0;
+    }
+    else if (segment == 1)
+    {
+	jerk = 0.0;
+	accel = _scurvePeakAccel;
+	speed = _scurveV1 + accel * (time - _scurveSegmentTime[1]);
+    }
+    else if (segment == 2)
+    {
+	float tau = time - _scurveSegmentTime[2];
+	jerk = -_jerk;
+	accel = _scurvePeakAccel - _jerk * tau;
+	speed = _scurveV2 + tau * (_scurvePeakAccel + accel) / 2.0;
+    }
+    else
+	return distance / _scurvePeak;
+    // Going back covers v.dt - a.dt^2/2 + j.dt^3/6 rather than v.dt + a.dt^2/2 + j.dt^3/6
+    float halfAccel = (backward ? -accel : accel) * 0.5;
+    float sixthJerk = jerk * (1.0 / 6.0);
+    // Solve by Newton's method. From a good guess this usually needs 1 division or none
+    float dt = guess;
+    if (dt <= 0.0)
+	dt = (speed > 0.0) ? distance / speed : pow(6.0 * distance / _jerk, 1.0 / 3.0);
+    for (uint8_t i = 0; i < 6; i++)
+    {
+	float error = dt * (speed + dt * (halfAccel + dt * sixthJerk)) - distance;
+	if (fabs(error) < distance * 0.00002)
+	    break;
+	dt -= error / (speed + dt * (2.0 * halfAccel + dt * 3.0 * sixthJerk));
+    }
+    return dt;
+}
+
+float AccelStepper::scurveInterval(long steps)
+{
+    boolean forward = (steps == _scurveTimeIndex);
+    if (!forward && steps + 1 != _scurveTimeIndex)
+    {
+	// Not next to the last step, which only happens at the start of a move or of a change
+	// between accelerating and decelerating, so start again from this step
+	_scurveTimeIndex = steps;
+	_scurveTime = scurveTime(steps);
+	_scurveInterval = 0.0;
+	_scurvePreviousInterval = 0.0;
+	forward = true;
+    }
+    float interval;
+    if (!forward && steps == 0)
+    {
+	// Back to stopped
+	interval = _scurveTime;
+	_scurveTime = 0.0;
+    }
+    else
+    {
+	// Cover the step a segment at a time, where a step crosses from one segment to the next
+	// the time at the join is known, so the interval carries on smoothly
+	float position = forward ? steps : steps + 1;
+	float remaining = 1.0;
+	uint8_t segment = 0;
+	interval = 0.0;
+	while (segment < 3 && (forward ? position >= _scurveSegmentSteps[segment + 1] : position > _scurveSegmentSteps[segment + 1]))
+	    segment++;
+	while (true)
+	{
+	    float join = forward ? ((segment < 3) ? _scurveSegmentSteps[segment + 1] - position : remaining)
+				 : position - _scurveSegmentSteps[segment];
+	    if (join >= remaining)
+	    {
+		// Within a segment the interval changes smoothly, so carry on from the last two
+		float guess = 0.0;
+		if (remaining == 1.0)
+		    guess = (_scurvePreviousInterval > 0.0) ? 2.0 * _scurveInterval - _scurvePreviousInterval : _scurveInterval;
+		float dt = scurveSegmentTime(segment, _scurveTime, remaining, !forward, guess);
+		interval += dt;
+		_scurveTime += forward ? dt : -dt;
+		break;
+	    }
+	    interval += scurveSegmentTime(segment, _scurveTime, join, !forward, 0.0);
+	    remaining -= join;
+	    position += forward ? join : -join;
+	    if (forward)
+		segment++;
+	    _scurveTime = _scurveSegmentTime[segment];
+	    if (!forward)
+		segment--;
+	}
+    }
+    _scurveTimeIndex = forward ? steps + 1 : steps;
+    _scurvePreviousInterval = _scurveInterval;
+    _scurveInterval = interval;
+    return interval;
+}
+
+long AccelStepper::scurveStepsToStop()
+{
+    // Deceleration mirrors acceleration, so stopping takes as many steps as it took to get here
+    if (_n > 0)
+	return (_n < _scurveRampSteps) ? _n : _scurveRampSteps;
+    return -_n;
+}
+
+unsigned long AccelStepper::computeSCurveSpeed()
+{
+    long distanceTo = distanceToGo(); // +ve is clockwise from curent location
+    long stepsToStop = scurveStepsToStop();
+
+    if (distanceTo == 0 && stepsToStop <= 1)
+    {
+	// We are at the target and its time to stop
+	_stepInterval = 0;
+	_speed = 0.0;
+	_n = 0;
+	return _stepInterval;
+    }
+
+    // Start decelerating or accelerating again as per computeNewSpeed()
+    if (_n > 0)
+    {
+	if ((distanceTo > 0 && (stepsToStop >= distanceTo || _direction == DIRECTION_CCW))
+	    || (distanceTo < 0 && (stepsToStop >= -distanceTo || _direction == DIRECTION_CW)))
+	    _n = -stepsToStop;
+    }
+    else if (_n < 0)
+    {
+	if ((distanceTo > 0 && stepsToStop < distanceTo && _direction == DIRECTION_CW)
+	    || (distanceTo < 0 && stepsToStop < -distanceTo && _direction == DIRECTION_CCW))
+	    _n = -_n;
+    }
+
+    float interval;
+    if (_scurvePeak == 0.0)
+	planSCurve(0x7FFFFFFF); // Selected RAMP_SCURVE while moving
+    if (_n == 0)
+    {
+	// First step from stopped, plan the move. _speed only tracks the direction
+	planSCurve((distanceTo > 0) ? distanceTo : -distanceTo);
+	_direction = (distanceTo > 0) ? DIRECTION_CW : DIRECTION_CCW;
+	_speed = (_direction == DIRECTION_CW) ? _maxSpeed : -_maxSpeed;
+    }
+    // Each interval follows on from the one before, decelerating steps back down the acceleration ramp
+    if (_n >= _scurveRampSteps)
+	interval = 1.0 / _scurvePeak; // Cruising
+    else if (_n >= 0)
+	interval = scurveInterval(_n);
+    else
+	interval = scurveInterval(-_n - 1);
+    _n++;
+    _stepInterval = interval * 1000000.0;
+    return _stepInterval;
+}
+
 void AccelStepper::setSpeed(float speed)
 {
     if (speed == _speed)
@@ -321,42 +786,121 @@ void AccelStepper::setSpeed(float speed)
 
 float AccelStepper::speed()
 {
+    // The fixed point and S-curve engines only track the direction in _speed
+    if ((fixedRamp() || scurveRamp()) && _stepInterval && _speed != 0.0)
+	return (_speed > 0.0) ? 1000000.0 / _stepInterval : -1000000.0 / _stepInterval;
     return _speed;
 }
 
-// Subclasses can override
-void AccelStepper::step(long step)
+void AccelStepper::setRampEngine(RampEngine engine)
 {
-    switch (_interface)
+    if (engine == _rampEngine)
+	return;
+    // Carry the current speed over so a ramp in progress continues smoothly
+    float currentSpeed = this->speed();
+    if (fixedRamp())
+	_cn = _cnFixed / 256.0;
+    else if (scurveRamp() && currentSpeed != 0.0 && _acceleration != 0.0)
     {
-        case FUNCTION:
-            step0(step);
-            break;
+	_cn = 1000000.0 / fabs(currentSpeed);
+	_n = (long)((currentSpeed * currentSpeed) / (2.0 * _acceleration)); // Equation 16
+    }
+    _speed = currentSpeed;
+    _rampEngine = engine;
+    if (fixedRamp())
+	_cnFixed = (unsigned long)(_cn * 256.0);
+    buildRampTable();
+}
 
-	case DRIVER:
-	    step1(step);
-	    break;
-    
-	case FULL2WIRE:
-	    step2(step);
-	    break;
-    
-	case FULL3WIRE:
-	    step3(step);
-	    break;  
+boolean AccelStepper::fixedRamp()
+{
+    return _rampEngine == RAMP_FIXED || _rampEngine == RAMP_TABLE;
+}
+
+void AccelStepper::setRampTable(uint16_t* table, uint16_t size)
+{
+    _rampTable = table;
+    _rampTableSize = size;
+    buildRampTable();
+}
 
-	case FULL4WIRE:
-	    step4(step);
-	    break;  
+void AccelStepper::buildRampTable()
+{
+    RampParameters params;
+    rampParameters(params, _maxSpeed, _acceleration, _rampTable);
+    applyRampParameters(params);
+}
 
-	case HALF3WIRE:
-	    step6(step);
-	    break;  
-		
-	case HALF4WIRE:
-	    step8(step);
-	    break;  
+void AccelStepper::buildRampTable(RampParameters& params)
+{
+    params.rampTableLength = 0;
+    params.rampTableStride = 0;
+    params.rampTableShift = 0;
+    uint16_t* table = params.rampTable;
+    if (_rampEngine != RAMP_TABLE || !table || !_rampTable || _rampTableSize < 2 || params.acceleration == 0.0)
+	return;
+    // Use the smallest power of 2 stride that fits the whole ramp up to maxSpeed in the table
+    while (params.rampTableStride < 15 && ((unsigned long)params.maxStopSteps >> params.rampTableStride) >= _rampTableSize - 1UL)
+	params.rampTableStride++;
+    // Scale the 24.8 fixed point intervals so the longest fits in 16 bits
+    while ((params.c0Fixed >> params.rampTableShift) > 0xFFFF)
+	params.rampTableShift++;
+    // Interval between step n and n + 1 at constant acceleration is sqrt(2 / a) * (sqrt(n + 1) - sqrt(n))
+    float scale = sqrt(2.0 / params.acceleration) * 256000000.0 / (1UL << params.rampTableShift);
+    uint16_t cmin = params.cminFixed >> params.rampTableShift;
+    while (params.rampTableLength < _rampTableSize)
+    {
+	float n = (float)((unsigned long)params.rampTableLength << params.rampTableStride);
+	float interval = scale / (sqrt(n + 1.0) + sqrt(n));
+	if (interval <= cmin)
+	{
+	    table[params.rampTableLength++] = cmin;
+	    break;
+	}
+	table[params.rampTableLength++] = (interval < 65535.0) ? (uint16_t)(interval + 0.5) : 0xFFFF;
+    }
+}
+
+boolean AccelStepper::rampTableLookup()
+{
+    if (_rampTableLength < 2)
+	return false;
+    // Decelerating from -n mirrors the interval from acceleration step n - 1
+    unsigned long n = (_n > 0) ? _n : -_n - 1;
+    // The start of the ramp changes too quickly to interpolate, use Equation 13
+    if (n < (8UL << _rampTableStride))
+	return false;
+    unsigned long k = n >> _rampTableStride;
+    if (k + 1 >= _rampTableLength)
+    {
+	// Beyond the end of the table, which either finished at maxSpeed or ran out of entries
+	if (_rampTable[_rampTableLength - 1] > (_cminFixed >> _rampTableShift))
+	    return false;
+	_cnFixed = _cminFixed;
+	return true;
     }
+    uint16_t fraction = n & ((1UL << _rampTableStride) - 1);
+    uint16_t interval = _rampTable[k] - (((unsigned long)(_rampTable[k] - _rampTable[k + 1]) * fraction) >> _rampTableStride);
+    _cnFixed = (unsigned long)interval << _rampTableShift;
+    return true;
+}
+
+AccelStepper::RampEngine AccelStepper::rampEngine()
+{
+    return (RampEngine)_rampEngine;
+}
+
+long AccelStepper::fixedStepsToStop()
+{
+    // _n has already been advanced past the step just computed
+    long n = (_n > 0) ? _n - 1 : -_n;
+    return (n < _maxStopSteps) ? n : _maxStopSteps;
+}
+
+// Subclasses can override
+void AccelStepper::step(long step)
+{
+    (this->*_stepFunction)(step);
 }
 
 long AccelStepper::stepForward()
@@ -383,12 +927,38 @@ long AccelStepper::stepBackward()
 // ....
 void AccelStepper::setOutputPins(uint8_t mask)
 {
+    uint8_t i;
+#if defined(ACCELSTEPPER_FAST_OUTPUTS)
+    if (_fastOutputs)
+    {
+	// Unused pins have no bits so are left alone
+	AccelStepperPortMask set = 0;
+	AccelStepperPortMask clear = 0;
+	for (i = 0; i < 4; i++)
+	{
+	    if (((mask >> i) ^ _pinInverted[i]) & 1)
+		set |= _outputBit[i];
+	    else
+		clear |= _outputBit[i];
+	}
+#if defined(ARDUINO_ARCH_AVR)
+	// Other pins on the port may be written from interrupts, so update it atomically
+	uint8_t oldSREG = SREG;
+	cli();
+	*_outputRegister = (*_outputRegister & ~clear) | set;
+	SREG = oldSREG;
+#else
+	REG_WRITE(GPIO_OUT_W1TC_REG, clear);
+	REG_WRITE(GPIO_OUT_W1TS_REG, set);
+#endif
+	return;
+    }
+#endif
     uint8_t numpins = 2;
     if (_interface == FULL4WIRE || _interface == HALF4WIRE)
 	numpins = 4;
     else if (_interface == FULL3WIRE || _interface == HALF3WIRE)
 	numpins = 3;
-    uint8_t i;
     for (i = 0; i < numpins; i++)
 	digitalWrite(_pin[i], (mask & (1 << i)) ? (HIGH ^ _pinInverted[i]) : (LOW ^ _pinInverted[i]));
 }
@@ -412,7 +982,19 @@ void AccelStepper::step1(long step)
 
     // _pin[0] is step, _pin[1] is direction
     setOutputPins(_direction ? 0b10 : 0b00); // Set direction first else get rogue pulses
+#if defined(ESP32) && defined(ACCELSTEPPER_FAST_OUTPUTS)
+    // Port writes are fast enough to violate the direction setup time
+    if (_fastOutputs)
+	delayMicroseconds(1);
+#endif
     setOutputPins(_direction ? 0b11 : 0b01); // step HIGH
+    if (_nonBlockingPulse)
+    {
+	// finishStepPulse() sets step LOW
+	_pulseStartTime = micros();
+	_pulseActive = true;
+	return;
+    }
     // Caution 200ns setup time 
     // Delay the minimum allowed pulse width
     delayMicroseconds(_minPulseWidth);
@@ -572,6 +1154,7 @@ void    AccelStepper::disableOutputs()
     if (! _interface) return;
 
     setOutputPins(0); // Handles inversion automatically
+    _pulseActive = false;
     if (_enablePin != 0xff)
     {
         pinMode(_enablePin, OUTPUT);
@@ -596,6 +1179,10 @@ void    AccelStepper::enableOutputs()
         pinMode(_pin[2], OUTPUT);
     }
 
+#if defined(ACCELSTEPPER_FAST_OUTPUTS)
+    setupFastOutputs();
+#endif
+
     if (_enablePin != 0xff)
     {
         pinMode(_enablePin, OUTPUT);
@@ -603,11 +1190,96 @@ void    AccelStepper::enableOutputs()
     }
 }
 
+#if defined(ACCELSTEPPER_FAST_OUTPUTS)
+void AccelStepper::setupFastOutputs()
+{
+    uint8_t numpins = 2;
+    if (_interface == FULL4WIRE || _interface == HALF4WIRE)
+	numpins = 4;
+    else if (_interface == FULL3WIRE || _interface == HALF3WIRE)
+	numpins = 3;
+    uint8_t i;
+    _fastOutputs = false;
+    for (i = 0; i < 4; i++)
+	_outputBit[i] = 0;
+#if defined(ARDUINO_ARCH_AVR)
+    uint8_t port = digitalPinToPort(_pin[0]);
+    if (port == NOT_A_PIN)
+	return;
+    for (i = 0; i < numpins; i++)
+    {
+	if (digitalPinToPort(_pin[i]) != port)
+	{
+	    // Pins are on different ports, fall back to digitalWrite()
+	    return;
+	}
+	_outputBit[i] = digitalPinToBitMask(_pin[i]);
+    }
+    _outputRegister = portOutputRegister(port);
+#else
+    for (i = 0; i < numpins; i++)
+    {
+	if (_pin[i] >= 32)
+	{
+	    // GPIO32 and above are in a second register, fall back to digitalWrite()
+	    return;
+	}
+	_outputBit[i] = 1UL << _pin[i];
+    }
+#endif
+    _fastOutputs = true;
+}
+#endif
+
 void AccelStepper::setMinPulseWidth(unsigned int minWidth)
 {
     _minPulseWidth = minWidth;
 }
 
+void AccelStepper::setNonBlockingPulse(boolean nonBlocking)
+{
+    _nonBlockingPulse = nonBlocking;
+}
+
+void AccelStepper::setMaxCatchUp(unsigned long maxCatchUp)
+{
+    _maxCatchUp = maxCatchUp;
+}
+
+unsigned long AccelStepper::maxLateness()
+{
+    return _latenessMax;
+}
+
+unsigned long AccelStepper::meanLateness()
+{
+    return _latenessCount ? _latenessTotal / _latenessCount : 0;
+}
+
+unsigned long AccelStepper::latenessCount()
+{
+    return _latenessCount;
+}
+
+void AccelStepper::resetLateness()
+{
+    _latenessTotal = 0;
+    _latenessMax = 0;
+    _latenessCount = 0;
+}
+
+boolean AccelStepper::finishStepPulse()
+{
+    if (!_pulseActive)
+	return true;
+    // Allow for the resolution of micros() so the pulse is never shorter than the minimum
+    if (micros() - _pulseStartTime < (unsigned long)_minPulseWidth + MICROS_RESOLUTION)
+	return false;
+    setOutputPins(_direction ? 0b10 : 0b00); // step LOW
+    _pulseActive = false;
+    return true;
+}
+
 void AccelStepper::setEnablePin(uint8_t enablePin)
 {
     _enablePin = enablePin;
@@ -665,7 +1337,13 @@ void AccelStepper::stop()
 {
     if (_speed != 0.0)
     {    
-	long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)) + 1; // Equation 16 (+integer rounding)
+	long stepsToStop;
+	if (fixedRamp())
+	    stepsToStop = fixedStepsToStop() + 1;
+	else if (scurveRamp())
+	    stepsToStop = scurveStepsToStop();
+	else
+	    stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)) + 1; // Equation 16 (+integer rounding)
 	if (_speed > 0)
 	    move(stepsToStop);
 	else
@@ -289,6 +289,15 @@
  #define YIELD
 #endif
 
+// Platforms where setOutputPins() can write the motor pins directly to the port registers
+#if defined(ARDUINO_ARCH_AVR)
+ #define ACCELSTEPPER_FAST_OUTPUTS
+ typedef uint8_t AccelStepperPortMask;
+#elif defined(ESP32)
+ #define ACCELSTEPPER_FAST_OUTPUTS
+ typedef uint32_t AccelStepperPortMask;
+#endif
+
 /////////////////////////////////////////////////////////////////////
 /// \class AccelStepper AccelStepper.h <AccelStepper.h>
 /// \brief Support for stepper motors with acceleration etc.
@@ -352,6 +361,16 @@ public:
 	HALF4WIRE = 8  ///< 4 wire half stepper, 4 motor pins required
     } MotorInterfaceType;
 
+    /// \brief Symbolic names for the ramp engines used by computeNewSpeed().
+    /// Use this with setRampEngine() to select how the acceleration ramp is calculated.
+    typedef enum
+    {
+	RAMP_FLOAT = 0, ///< Floating point Equation 13 and 16, as per the original library (default)
+	RAMP_FIXED = 1, ///< 24.8 fixed point Equation 13, no floating point maths per step
+	RAMP_TABLE = 2, ///< As RAMP_FIXED, but using a precomputed table of step intervals, see setRampTable()
+	RAMP_SCURVE = 3 ///< Jerk limited S-curve using floating point maths, see setJerk()
+    } RampEngine;
+
     /// Constructor. You can have multiple simultaneous steppers, all moving
     /// at different speeds and accelerations, provided you call their run()
     /// functions at frequent enough intervals. Current Position is set to 0, target
@@ -364,7 +383,7 @@ public:
     /// If an enable line is also needed, call setEnablePin() after construction.
     /// You may also invert the pins using setPinsInverted().
     /// Caution: DRIVER implements a blocking delay of minPulseWidth microseconds (default 1us) for each step.
-    /// You can change this with setMinPulseWidth().
+    /// You can change this with setMinPulseWidth(), or avoid it with setNonBlockingPulse().
     /// AccelStepper::FULL2WIRE (2) means a 2 wire stepper (2 pins required). 
     /// AccelStepper::FULL3WIRE (3) means a 3 wire stepper, such as HDD spindle (3 pins required). 
     /// AccelStepper::FULL4WIRE (4) means a 4 wire stepper (4 pins required). 
@@ -385,6 +404,39 @@ public:
     /// the output pins at construction time.
     AccelStepper(uint8_t interface = AccelStepper::FULL4WIRE, uint8_t pin1 = 2, uint8_t pin2 = 3, uint8_t pin3 = 4, uint8_t pin4 = 5, bool enable = true);
 
+    /// A step function, step0() to step8(), called by step() for the interface.
+    typedef void (AccelStepper::*StepFunction)(long step);
+
+    /// As the constructor above, but step() calls the given step function for the interface
+    /// rather than choosing it from the interface when constructed. If the interface is a
+    /// constant, use stepFunction(interface) so only that interface's step function is linked.
+    /// \param[in] function The step function to use, eg. stepFunction(AccelStepper::DRIVER)
+    AccelStepper(StepFunction function, uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4, bool enable = true);
+
+    /// The step function for the interface. This is inline, so a constant interface only
+    /// refers to its own step function and the others are left out of the build.
+    /// \param[in] interface The \ref MotorInterfaceType
+    static StepFunction stepFunction(uint8_t interface)
+    {
+	switch (interface)
+	{
+	    case DRIVER:
+		return &AccelStepper::step1;
+	    case FULL2WIRE:
+		return &AccelStepper::step2;
+	    case FULL3WIRE:
+		return &AccelStepper::step3;
+	    case FULL4WIRE:
+		return &AccelStepper::step4;
+	    case HALF3WIRE:
+		return &AccelStepper::step6;
+	    case HALF4WIRE:
+		return &AccelStepper::step8;
+	    default:
+		return &AccelStepper::step0;
+	}
+    }
+
     /// Alternate Constructor which will call your own functions for forward and backward steps. 
     /// You can have multiple simultaneous steppers, all moving
     /// at different speeds and accelerations, provided you call their run()
@@ -446,6 +498,19 @@ public:
     /// that was previously set by setAcceleration();
     /// \return The currently configured acceleration/deceleration
     float   acceleration();
+
+    /// Sets the jerk limit used by the RAMP_SCURVE engine. Rather than switching instantly
+    /// between 0 and the full acceleration at the start and end of each ramp, the acceleration
+    /// changes at no more than this rate, so speed changes smoothly. Lower values are gentler,
+    /// and the time to reach full acceleration is acceleration / jerk seconds.
+    /// Until this is set RAMP_SCURVE behaves as RAMP_FLOAT. Changes take effect from the next
+    /// move started from stopped.
+    /// \param[in] jerk The desired jerk in steps per second per second per second. Must be > 0.0.
+    void    setJerk(float jerk);
+
+    /// Returns the jerk limit previously set by setJerk()
+    /// \return The currently configured jerk
+    float   jerk();
     
     /// Sets the desired constant speed for use with runSpeed().
     /// \param[in] speed The desired constant speed in steps per
@@ -457,9 +522,47 @@ public:
     void    setSpeed(float speed);
 
     /// The most recently set speed.
+    /// With the RAMP_FIXED engine this is derived from the current step interval.
     /// \return the most recent speed in steps per second
     float   speed();
 
+    /// Selects the engine used to calculate the acceleration ramp.
+    /// RAMP_FLOAT is the original floating point implementation. RAMP_FIXED keeps the
+    /// step interval in 24.8 fixed point microseconds and replaces the three floating point
+    /// divisions per step with a single 32 bit integer division, which is considerably
+    /// faster on 8 bit processors such as the ATmega328.
+    /// Compared with RAMP_FLOAT over speeds of 1 to 10000 steps per second and accelerations
+    /// of 1 to 10000 steps per second per second, each step interval of RAMP_FIXED is within
+    /// 1 microsecond or 0.2% (whichever is greater) of the matching RAMP_FLOAT interval,
+    /// deceleration starts within 1 step of RAMP_FLOAT, and the total move time is within 0.5%.
+    /// RAMP_FIXED does not overshoot the target on long ramps where RAMP_FLOAT occasionally does.
+    /// RAMP_SCURVE limits the rate of change of acceleration as set by setJerk(), so both speed
+    /// and acceleration change smoothly. Each move from stopped is planned to reach maxSpeed, or
+    /// for short moves the highest speed from which it can decelerate smoothly to the target, and
+    /// each step interval is calculated exactly from the time taken to reach that step. Speed,
+    /// acceleration and jerk changes made while moving take effect from the next move, and changing
+    /// the target while moving may change the acceleration abruptly, as it does with RAMP_FLOAT.
+    /// RAMP_SCURVE uses a similar amount of floating point maths per step to RAMP_FLOAT.
+    /// \param[in] engine The ramp engine to use, see RampEngine
+    void    setRampEngine(RampEngine engine);
+
+    /// Returns the ramp engine previously set by setRampEngine()
+    /// \return The ramp engine in use
+    RampEngine rampEngine();
+
+    /// Provides the storage for the RAMP_TABLE engine. The table holds the step intervals
+    /// from stopped up to maxSpeed, and is rebuilt whenever setMaxSpeed() or setAcceleration()
+    /// change the ramp, so repeated moves only look up and interpolate the next interval.
+    /// If the ramp has more steps than the table has entries, every 2nd, 4th, 8th etc. interval
+    /// is stored and the intervals in between are linearly interpolated. Steps before the 8th
+    /// entry are always calculated per Equation 13, as they change too quickly to interpolate.
+    /// Deceleration mirrors the acceleration intervals, so intervals are within 1% of RAMP_FIXED
+    /// (up to 2.5% for the first deceleration steps of ramps under 20 steps) and the total move time
+    /// within 0.5%. Building the table takes one square root per entry.
+    /// \param[in] table Pointer to an array of at least 2 entries, which must remain valid
+    /// \param[in] size The number of entries in the table
+    void    setRampTable(uint16_t* table, uint16_t size);
+
     /// The distance from the current position to the target position.
     /// \return the distance from the current position to the target position
     /// in steps. Positive is clockwise from the current position.
@@ -519,6 +622,9 @@ public:
     /// Enable motor pin outputs by setting the motor pins to OUTPUT
     /// mode. Called automatically by the constructor.
     /// If the enable Pin is defined, sets it to OUTPUT mode and sets the pin to enabled.
+    /// On AVR, when all the motor pins are on the same port, and on ESP32, when all the motor
+    /// pins are below GPIO32, this also maps the pins to their port register bits so
+    /// setOutputPins() updates all the pins with a single port write instead of digitalWrite().
     virtual void    enableOutputs();
 
     /// Sets the minimum pulse width allowed by the stepper driver. The minimum practical pulse width is 
@@ -527,6 +633,40 @@ public:
     /// \param[in] minWidth The minimum pulse width in microseconds. 
     void    setMinPulseWidth(unsigned int minWidth);
 
+    /// Sets whether DRIVER step pulses are generated without blocking. By default step1() holds
+    /// the step pin high for minPulseWidth using delayMicroseconds(). When non blocking, step1()
+    /// raises the step pin and returns, and run() lowers it again once minPulseWidth has passed,
+    /// normally straight after calculating the new speed, or else on a later call. The pin is
+    /// always lowered before the next step. run() or runSpeed() must keep being called after the
+    /// last step of a move so the final pulse is ended.
+    /// \param[in] nonBlocking True to raise and lower the step pin on separate calls
+    void    setNonBlockingPulse(boolean nonBlocking);
+
+    /// Sets how runSpeed() schedules steps. By default (0) each step is timed from when the previous
+    /// step actually happened, so every late call to run() permanently slows the move. When set,
+    /// each step is timed from when the previous step was due, so the move keeps to the profile,
+    /// and a late step is caught up on the following steps by at most maxCatchUp microseconds.
+    /// Anything later than that is lost, so a long stall can't cause a burst of fast steps.
+    /// \param[in] maxCatchUp The most a step will be brought forward to catch up, in microseconds,
+    /// or 0 to time each step from the previous one
+    void    setMaxCatchUp(unsigned long maxCatchUp);
+
+    /// Returns the latest a step has been taken by runSpeed(), in microseconds after it was due,
+    /// since resetLateness(). The first step of each move isn't counted.
+    /// \return The maximum lateness in microseconds
+    unsigned long maxLateness();
+
+    /// Returns the average lateness of the steps taken by runSpeed() since resetLateness()
+    /// \return The mean lateness in microseconds
+    unsigned long meanLateness();
+
+    /// Returns the number of steps included in maxLateness() and meanLateness()
+    /// \return The number of steps
+    unsigned long latenessCount();
+
+    /// Clears the step lateness statistics
+    void    resetLateness();
+
     /// Sets the enable pin number for stepper drivers.
     /// 0xFF indicates unused (default).
     /// Otherwise, if a pin is set, the pin will be turned on when 
@@ -586,8 +726,9 @@ protected:
 
     /// Called to execute a step. Only called when a new step is
     /// required. Subclasses may override to implement new stepping
-    /// interfaces. The default calls step1(), step2(), step4() or step8() depending on the
-    /// number of pins defined for the stepper.
+    /// interfaces. The default calls the step function chosen for the interface when
+    /// constructed, step1(), step2(), step4() or step8() depending on the number of pins.
+    /// The step functions aren't virtual, so only those used are linked.
     /// \param[in] step The current step phase number (0 to 7)
     virtual void   step(long step);
     
@@ -604,49 +745,80 @@ protected:
     /// Called to execute a step using stepper functions (pins = 0) Only called when a new step is
     /// required. Calls _forward() or _backward() to perform the step
     /// \param[in] step The current step phase number (0 to 7)
-    virtual void   step0(long step);
+    void           step0(long step);
 
     /// Called to execute a step on a stepper driver (ie where pins == 1). Only called when a new step is
-    /// required. Subclasses may override to implement new stepping
-    /// interfaces. The default sets or clears the outputs of Step pin1 to step, 
+    /// required. Sets or clears the outputs of Step pin1 to step, 
     /// and sets the output of _pin2 to the desired direction. The Step pin (_pin1) is pulsed for 1 microsecond
     /// which is the minimum STEP pulse width for the 3967 driver.
     /// \param[in] step The current step phase number (0 to 7)
-    virtual void   step1(long step);
+    void           step1(long step);
 
     /// Called to execute a step on a 2 pin motor. Only called when a new step is
-    /// required. Subclasses may override to implement new stepping
-    /// interfaces. The default sets or clears the outputs of pin1 and pin2
+    /// required. Sets or clears the outputs of pin1 and pin2
     /// \param[in] step The current step phase number (0 to 7)
-    virtual void   step2(long step);
+    void           step2(long step);
 
     /// Called to execute a step on a 3 pin motor, such as HDD spindle. Only called when a new step is
-    /// required. Subclasses may override to implement new stepping
-    /// interfaces. The default sets or clears the outputs of pin1, pin2,
+    /// required. Sets or clears the outputs of pin1, pin2,
     /// pin3
     /// \param[in] step The current step phase number (0 to 7)
-    virtual void   step3(long step);
+    void           step3(long step);
 
     /// Called to execute a step on a 4 pin motor. Only called when a new step is
-    /// required. Subclasses may override to implement new stepping
-    /// interfaces. The default sets or clears the outputs of pin1, pin2,
+    /// required. Sets or clears the outputs of pin1, pin2,
     /// pin3, pin4.
     /// \param[in] step The current step phase number (0 to 7)
-    virtual void   step4(long step);
+    void           step4(long step);
 
     /// Called to execute a step on a 3 pin motor, such as HDD spindle. Only called when a new step is
-    /// required. Subclasses may override to implement new stepping
-    /// interfaces. The default sets or clears the outputs of pin1, pin2,
+    /// required. Sets or clears the outputs of pin1, pin2,
     /// pin3
     /// \param[in] step The current step phase number (0 to 7)
-    virtual void   step6(long step);
+    void           step6(long step);
 
     /// Called to execute a step on a 4 pin half-stepper motor. Only called when a new step is
-    /// required. Subclasses may override to implement new stepping
-    /// interfaces. The default sets or clears the outputs of pin1, pin2,
+    /// required. Sets or clears the outputs of pin1, pin2,
     /// pin3, pin4.
     /// \param[in] step The current step phase number (0 to 7)
-    virtual void   step8(long step);
+    void           step8(long step);
+
+    /// Lowers the step pin raised by step1() in non blocking pulse mode, if minPulseWidth has passed.
+    /// \return true if there is no step pulse still to be ended
+    boolean finishStepPulse();
+
+    /// The values setMaxSpeed() and setAcceleration() derive from maxSpeed and acceleration.
+    /// A subclass that steps from an interrupt can work them out with rampParameters() while
+    /// interrupts are enabled, and only hold them off for applyRampParameters().
+    struct RampParameters
+    {
+	float          maxSpeed;
+	float          acceleration;
+	float          c0;
+	float          cmin;
+	unsigned long  c0Fixed;
+	unsigned long  cminFixed;
+	long           maxStopSteps;
+	float          stopStepsPerSpeedSquared; ///< 1 / (2 * acceleration), for Equation 16
+	float          accelerationRatio;        ///< Old acceleration / new, for Equation 17
+	uint16_t*      rampTable;                ///< Where the RAMP_TABLE intervals were built
+	uint16_t       rampTableLength;
+	uint8_t        rampTableStride;
+	uint8_t        rampTableShift;
+    };
+
+    /// Works out the ramp for a new maxSpeed and acceleration, without changing the stepper.
+    /// \param[out] params The ramp values
+    /// \param[in] maxSpeed The new maxSpeed, already made positive
+    /// \param[in] acceleration The new acceleration, positive and not 0
+    /// \param[in] table Where to build the RAMP_TABLE intervals, with as many entries as given to
+    /// setRampTable(), or NULL to do without the table until the next change
+    void    rampParameters(RampParameters& params, float maxSpeed, float acceleration, uint16_t* table);
+
+    /// Puts a ramp from rampParameters() in place, copying its table into the one given to
+    /// setRampTable(), and adjusts a move in progress to it. This does little floating point maths.
+    /// \param[in] params The ramp values
+    void    applyRampParameters(const RampParameters& params);
 
     /// Current direction motor is spinning in
     /// Protected because some peoples subclasses need it to be so
@@ -661,6 +833,9 @@ private:
     /// bipolar, and 4 pins is a unipolar.
     uint8_t        _interface;          // 0, 1, 2, 4, 8, See MotorInterfaceType
 
+    /// The step function called by step() for the interface
+    StepFunction   _stepFunction;
+
     /// Arduino pin number assignments for the 2 or 4 pins required to interface to the
     /// stepper motor or driver
     uint8_t        _pin[4];
@@ -668,6 +843,22 @@ private:
     /// Whether the _pins is inverted or not
     uint8_t        _pinInverted[4];
 
+#if defined(ACCELSTEPPER_FAST_OUTPUTS)
+    /// Port register bit for each of _pin, or 0 if the pin is unused. Set by enableOutputs()
+    AccelStepperPortMask _outputBit[4];
+
+    /// True if setOutputPins() writes the port register directly rather than using digitalWrite()
+    boolean        _fastOutputs;
+
+#if defined(ARDUINO_ARCH_AVR)
+    /// The AVR output port register all of the _pins are on
+    volatile uint8_t* _outputRegister;
+#endif
+
+    /// Maps _pin to the port register bits, enabling _fastOutputs if all the pins can be written together
+    void setupFastOutputs();
+#endif
+
     /// The current absolution position in steps.
     long           _currentPos;    // Steps
 
@@ -694,6 +885,24 @@ private:
     /// The minimum allowed pulse width in microseconds
     unsigned int   _minPulseWidth;
 
+    /// True if step1() leaves the step pin high for finishStepPulse() to lower, see setNonBlockingPulse()
+    boolean        _nonBlockingPulse;
+
+    /// True while a non blocking step pulse is high, and the time it started in microseconds
+    boolean        _pulseActive;
+    unsigned long  _pulseStartTime;
+
+    /// Limit on catching up late steps in microseconds, 0 to time steps from the previous step, see setMaxCatchUp()
+    unsigned long  _maxCatchUp;
+
+    /// True if the next step follows on from a previous step, false if it starts a move
+    boolean        _stepScheduled;
+
+    /// Step lateness statistics, see maxLateness()
+    unsigned long  _latenessTotal;
+    unsigned long  _latenessMax;
+    unsigned long  _latenessCount;
+
     /// Is the direction pin inverted?
     ///bool           _dirInverted; /// Moved to _pinInverted[1]
 
@@ -724,6 +933,118 @@ private:
     /// Min step size in microseconds based on maxSpeed
     float _cmin; // at max speed
 
+    /// The ramp engine in use, see RampEngine
+    uint8_t _rampEngine;
+
+    /// Initial step size for RAMP_FIXED, in 1/256 microseconds
+    unsigned long _c0Fixed;
+
+    /// Last step size for RAMP_FIXED, in 1/256 microseconds
+    unsigned long _cnFixed;
+
+    /// Min step size for RAMP_FIXED, in 1/256 microseconds
+    unsigned long _cminFixed;
+
+    /// Steps required to stop from maxSpeed (Equation 16), used by RAMP_FIXED
+    long _maxStopSteps;
+
+    /// Step interval table for RAMP_TABLE, in units of (1 << _rampTableShift) / 256 microseconds
+    uint16_t* _rampTable;
+
+    /// Number of entries available in _rampTable
+    uint16_t _rampTableSize;
+
+    /// Number of entries currently filled in _rampTable
+    uint16_t _rampTableLength;
+
+    /// log2 of the number of ramp steps between each _rampTable entry
+    uint8_t _rampTableStride;
+
+    /// log2 of the number of 1/256 microseconds per unit in _rampTable
+    uint8_t _rampTableShift;
+
+    /// Fills _rampTable from the current acceleration and maxSpeed
+    void buildRampTable();
+
+    /// Fills params.rampTable from the acceleration and maxSpeed in params
+    void buildRampTable(RampParameters& params);
+
+    /// Sets _cnFixed from _rampTable for the current _n
+    /// \return true if the interval was found in the table, false if Equation 13 is required
+    boolean rampTableLookup();
+
+    /// Jerk limit for RAMP_SCURVE in steps/sec/sec/sec
+    float _jerk;
+
+    /// Peak speed of the current RAMP_SCURVE move, maxSpeed unless the move is too short to reach it
+    float _scurvePeak;
+
+    /// Peak acceleration of the current RAMP_SCURVE move, acceleration unless the ramp is too short to reach it
+    float _scurvePeakAccel;
+
+    /// Steps to accelerate from stopped to _scurvePeak
+    long _scurveRampSteps;
+
+    /// The RAMP_SCURVE segments of the current move, set by planSCurve() so they aren't calculated
+    /// on every step. The acceleration rises at the jerk limit to _scurvePeakAccel over _scurveJerkTime,
+    /// holds, then falls back to 0 at _scurvePeak. _scurveV1 and _scurveV2 are the speeds the hold
+    /// starts and ends at, and each segment starts at _scurveSegmentSteps from stopped at _scurveSegmentTime
+    float _scurveJerkTime;
+    float _scurveV1;
+    float _scurveV2;
+    float _scurveSegmentSteps[4];
+    float _scurveSegmentTime[4];
+
+    /// The last step calculated by scurveInterval(), the time it is reached from stopped, and the
+    /// last two intervals calculated
+    long _scurveTimeIndex;
+    float _scurveTime;
+    float _scurveInterval;
+    float _scurvePreviousInterval;
+
+    /// True if the selected engine uses the fixed point step interval _cnFixed
+    boolean fixedRamp();
+
+    /// True if RAMP_SCURVE is selected and a jerk limit has been set
+    boolean scurveRamp();
+
+    /// Plans the RAMP_SCURVE peak speed and acceleration for a move starting from stopped
+    /// \param[in] distance Number of steps to the target
+    void planSCurve(long distance);
+
+    /// Time taken to accelerate from stopped through the given number of steps with RAMP_SCURVE,
+    /// calculated from scratch, see scurveInterval()
+    /// \param[in] steps Steps from stopped
+    /// \return Time in seconds
+    float scurveTime(long steps);
+
+    /// Time between step steps and step steps + 1 while accelerating from stopped with RAMP_SCURVE.
+    /// If steps or steps + 1 was the last step calculated, the interval is found from the speed and
+    /// acceleration there, otherwise scurveTime() is used to start again from steps.
+    /// \param[in] steps Steps from stopped
+    /// \return Time in seconds
+    float scurveInterval(long steps);
+
+    /// Time to cover distance steps from a point in a RAMP_SCURVE segment, going back if backward
+    /// \param[in] segment Segment 0 to 3, see _scurveSegmentSteps
+    /// \param[in] time Time from stopped the distance is covered from
+    /// \param[in] distance Steps to cover, no further than the end of the segment
+    /// \param[in] backward True to find the time to get to time from distance steps before
+    /// \param[in] guess Estimate of the time, or 0 if there isn't one
+    /// \return Time in seconds
+    float scurveSegmentTime(uint8_t segment, float time, float distance, boolean backward, float guess);
+
+    /// Steps required to stop from the current RAMP_SCURVE speed
+    long scurveStepsToStop();
+
+    /// Implements computeNewSpeed() for RAMP_SCURVE
+    unsigned long computeSCurveSpeed();
+
+    /// Steps required to stop from the current speed, as used by RAMP_FIXED.
+    /// While accelerating or decelerating per Equation 13 this equals |_n|,
+    /// and while cruising it is capped at the steps required to stop from maxSpeed.
+    long fixedStepsToStop();
+
 };
 
 /// @example Random.pde
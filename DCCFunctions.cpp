@@ -0,0 +1,243 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "defines.h"
+
+#if defined(DCC_ACCESSORY_ADDRESS)
+
+#include "DCCFunctions.h"
+#include "IOFunctions.h"
+#include "TurntableFunctions.h"
+
+#if TURNTABLE_EX_MODE == TRAVERSER && DCC_INPUT_PIN == LIMIT_SENSOR_PIN
+#error DCC_INPUT_PIN is also the traverser limit sensor, define DCC_INPUT_PIN as another pin that supports interrupts
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+#define DCC_EDGE_BUFFER_SIZE 64     // Edges waiting for processDCC(), a power of 2. A packet is around 90.
+#define DCC_ONE_MIN 48              // Half bit durations in microseconds, a 1 is nominally 58us.
+#define DCC_ONE_MAX 68
+#define DCC_ZERO_MIN 86             // A 0 is nominally 100us, and may be stretched.
+#define DCC_PREAMBLE_BITS 10        // Fewest preamble bits accepted before a packet.
+#define DCC_MAX_PACKET 6            // Longest packet in bytes, including the error byte.
+#define DCC_REPEAT_TIME 500         // Identical accessory packets within this many ms are repeats.
+
+// Decoder states.
+#define DCC_PREAMBLE 0
+#define DCC_DATA 1
+#define DCC_SEPARATOR 2
+
+// Offsets after the position table of the addresses for other activities.
+#define DCC_HOME 0
+#define DCC_CALIBRATE 1
+#define DCC_LED 2
+#define DCC_ACCESSORY 3
+
+// The time between edges in microseconds, written by dccEdge() and read by processDCC().
+static volatile uint8_t dccEdges[DCC_EDGE_BUFFER_SIZE];
+static volatile uint8_t dccEdgeHead = 0;
+static volatile uint8_t dccEdgeTail = 0;
+static volatile bool dccOverflow = false;   // Edges were lost, so the packet in progress is incomplete.
+
+static int8_t pendingHalf = -1;             // First half of the current bit, or -1 if waiting for it.
+static uint8_t dccState = DCC_PREAMBLE;
+static uint8_t preambleBits = 0;
+static uint8_t packet[DCC_MAX_PACKET];
+static uint8_t packetLength = 0;
+static uint8_t packetBits = 0;
+
+// Interrupt on every edge of the DCC signal, this must be quick so only records the time since the last edge.
+// With STEPPER_TIMER_INTERRUPT, an edge that arrives while a step is being taken isn't timed until the step
+// interrupt finishes, stretching one half bit and shortening the next. Those usually fall outside the
+// DCC_ONE/DCC_ZERO limits so the packet is dropped, and the error byte catches most of the rest. Command
+// stations repeat accessory packets, so this only delays a command while the turntable is moving.
+static void IRAM_ATTR dccEdge() {
+  static unsigned long lastEdge = 0;
+  unsigned long now = micros();
+  unsigned long period = now - lastEdge;
+  lastEdge = now;
+  uint8_t head = dccEdgeHead;
+  if ((uint8_t)(head - dccEdgeTail) >= DCC_EDGE_BUFFER_SIZE) {
+    dccOverflow = true;
+    return;
+  }
+  dccEdges[head & (DCC_EDGE_BUFFER_SIZE - 1)] = period > 255 ? 255 : period;
+  dccEdgeHead = head + 1;
+}
+
+// Function to start the DCC decoder.
+void setupDCC() {
+  int interrupt = digitalPinToInterrupt(DCC_INPUT_PIN);
+  if (interrupt < 0) {
+    Serial.print(F("ERROR: DCC_INPUT_PIN "));
+    Serial.print(DCC_INPUT_PIN);
+    Serial.println(F(" does not support interrupts, DCC decoder disabled"));
+    return;
+  }
+  pinMode(DCC_INPUT_PIN, INPUT);
+  attachInterrupt(interrupt, dccEdge, CHANGE);
+}
+
+// Function to start looking for the next preamble, preambleBits being any 1 bits already received.
+static void resetDCC(uint8_t bits) {
+  dccState = DCC_PREAMBLE;
+  preambleBits = bits;
+}
+
+// Function to act on an accessory address being closed or thrown.
+static void processDCCAccessory(uint16_t address, bool thrown) {
+  LOG_DEBUG(DCC_ACCESSORY, address, thrown);
+  if (address < DCC_ACCESSORY_ADDRESS) {
+    return;
+  }
+  uint16_t offset = address - DCC_ACCESSORY_ADDRESS;
+  if (offset < POSITION_TABLE_SIZE) {
+    // Either closed or thrown moves to the position, with the phase and direction stored with it.
+    processPositionCommand(offset);
+    return;
+  }
+  switch (offset - POSITION_TABLE_SIZE) {
+    case DCC_HOME:
+      if (thrown) processCommand(0, 2);
+      break;
+
+    case DCC_CALIBRATE:
+      if (thrown) processCommand(0, 3);
+      break;
+
+    case DCC_LED:
+      processCommand(0, thrown ? 4 : 7);
+      break;
+
+    case DCC_ACCESSORY:
+      processCommand(0, thrown ? 8 : 9);
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Function to check a complete packet, and act on it if it's for one of our accessory addresses.
+static void processDCCPacket() {
+  static uint16_t lastAddress = 0;
+  static bool lastThrown = false;
+  static unsigned long lastPacketMillis = 0;
+  uint8_t check = 0;
+  for (uint8_t i = 0; i < packetLength; i++) {
+    check ^= packet[i];
+  }
+  // Only basic accessory packets 10AAAAAA 1AAACDDD with the activate bit set are of interest.
+  if (check != 0 || packetLength != 3 || (packet[0] & 0xC0) != 0x80 || !(packet[1] & 0x80) || !(packet[1] & 0x08)) {
+    return;
+  }
+  uint16_t decoderAddress = (packet[0] & 0x3F) | ((~packet[1] & 0x70) << 2);
+  if (decoderAddress == 0) {
+    return;
+  }
+  uint16_t address = (decoderAddress - 1) * 4 + ((packet[1] >> 1) & 0x03) + 1;
+  bool thrown = packet[1] & 0x01;
+  // Command stations repeat each packet, so only act on the first.
+  unsigned long now = millis();
+  bool repeat = address == lastAddress && thrown == lastThrown && now - lastPacketMillis < DCC_REPEAT_TIME;
+  lastAddress = address;
+  lastThrown = thrown;
+  lastPacketMillis = now;
+  if (!repeat) {
+    processDCCAccessory(address, thrown);
+  }
+}
+
+// Function to add a received bit to the packet in progress.
+static void processDCCBit(uint8_t bit) {
+  switch (dccState) {
+    case DCC_PREAMBLE:
+      if (bit) {
+        if (preambleBits < 255) preambleBits++;
+      } else if (preambleBits >= DCC_PREAMBLE_BITS) {
+        // Packet start bit.
+        dccState = DCC_DATA;
+        packetLength = 0;
+        packetBits = 0;
+        packet[0] = 0;
+      } else {
+        preambleBits = 0;
+      }
+      break;
+
+    case DCC_DATA:
+      packet[packetLength] = (packet[packetLength] << 1) | bit;
+      if (++packetBits == 8) {
+        packetLength++;
+        dccState = DCC_SEPARATOR;
+      }
+      break;
+
+    case DCC_SEPARATOR:
+      if (bit) {
+        // Packet end bit, which may also be the first bit of the next preamble.
+        processDCCPacket();
+        resetDCC(1);
+      } else if (packetLength < DCC_MAX_PACKET) {
+        // Data byte start bit.
+        dccState = DCC_DATA;
+        packetBits = 0;
+        packet[packetLength] = 0;
+      } else {
+        resetDCC(0);
+      }
+      break;
+  }
+}
+
+// Function to decode the edges recorded by dccEdge(), called from loop().
+void processDCC() {
+  if (dccOverflow) {
+    dccOverflow = false;
+    pendingHalf = -1;
+    resetDCC(0);
+  }
+  while (dccEdgeTail != dccEdgeHead) {
+    uint8_t period = dccEdges[dccEdgeTail & (DCC_EDGE_BUFFER_SIZE - 1)];
+    dccEdgeTail = dccEdgeTail + 1;
+    int8_t half;
+    if (period >= DCC_ONE_MIN && period <= DCC_ONE_MAX) {
+      half = 1;
+    } else if (period >= DCC_ZERO_MIN) {
+      half = 0;
+    } else {
+      // Noise, or not a DCC signal.
+      pendingHalf = -1;
+      resetDCC(0);
+      continue;
+    }
+    // Both halves of a bit are the same, if they differ we're out of step so start the bit again from here.
+    if (pendingHalf != half) {
+      pendingHalf = half;
+      continue;
+    }
+    pendingHalf = -1;
+    processDCCBit(half);
+  }
+}
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * This file contains the DCC accessory decoder used when
+ * DCC_ACCESSORY_ADDRESS is defined. The pin change interrupt on
+ * DCC_INPUT_PIN only records the time between edges, and
+ * processDCC() assembles them into packets from loop().
+ *
+ * Accessory addresses from DCC_ACCESSORY_ADDRESS move to the
+ * positions stored with <P>, closed or thrown, using the phase
+ * stored with them. The four addresses after the position table home
+ * and calibrate when thrown, and turn the LED and accessory
+ * output on when thrown or off when closed.
+=============================================================*/
+
+#ifndef DCCFUNCTIONS_H
+#define DCCFUNCTIONS_H
+
+#include <Arduino.h>
+#include "defines.h"
+
+#if defined(DCC_ACCESSORY_ADDRESS)
+
+void setupDCC();
+void processDCC();
+
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * This file contains the stepper type used by the standard
+ * stepper definitions. The driver interface and pins are
+ * template parameters, so the step function for the interface
+ * is chosen at compile time and called directly on every step.
+ * The step functions of the other interfaces aren't referenced,
+ * so they're left out of the build.
+=============================================================*/
+
+#ifndef DRIVERSTEPPER_H
+#define DRIVERSTEPPER_H
+
+#include <Arduino.h>
+#include "AccelStepper.h"
+
+template <uint8_t Interface, uint8_t Pin1, uint8_t Pin2, uint8_t Pin3 = 2, uint8_t Pin4 = 3, class Base = AccelStepper>
+class DriverStepper : public Base {
+public:
+  DriverStepper() : Base(AccelStepper(AccelStepper::stepFunction(Interface), Interface, Pin1, Pin2, Pin3, Pin4)) {}
+
+  // Allows a definition to initialise the same driver on another base, eg. InterruptStepper.
+  DriverStepper(const AccelStepper &driver) : Base(driver) {}
+
+protected:
+  // Interface is a constant, so only the matching call is compiled and it isn't a virtual call.
+  void step(long step) {
+    switch (Interface) {
+      case AccelStepper::DRIVER:
+        this->AccelStepper::step1(step);
+        break;
+      case AccelStepper::FULL2WIRE:
+        this->AccelStepper::step2(step);
+        break;
+      case AccelStepper::FULL3WIRE:
+        this->AccelStepper::step3(step);
+        break;
+      case AccelStepper::FULL4WIRE:
+        this->AccelStepper::step4(step);
+        break;
+      case AccelStepper::HALF3WIRE:
+        this->AccelStepper::step6(step);
+        break;
+      case AccelStepper::HALF4WIRE:
+        this->AccelStepper::step8(step);
+        break;
+    }
+  }
+};
+
+// The stepper type for a stepper definition on the given base, eg. InterruptStepper.
+// Definitions that aren't a DriverStepper, such as a custom AccelStepper(...), use the base as is.
+template <class Driver, class Base>
+struct StepperType {
+  typedef Base type;
+};
+
+template <uint8_t Interface, uint8_t Pin1, uint8_t Pin2, uint8_t Pin3, uint8_t Pin4, class Base>
+struct StepperType<DriverStepper<Interface, Pin1, Pin2, Pin3, Pin4, AccelStepper>, Base> {
+  typedef DriverStepper<Interface, Pin1, Pin2, Pin3, Pin4, Base> type;
+};
+
+#endif
@@ -23,6 +23,27 @@
 
 char eepromFlag[4] = {'T', 'T', 'E', 'X'};          // EEPROM location 0 to 3 should contain TTEX if we have stored steps.
 const uint8_t eepromVersion = EEPROM_VERSION;       // Version of stored EEPROM data to invalidate stored steps if config changes.
+char positionTableFlag[4] = {'T', 'T', 'P', 'T'};   // EEPROM location POSITION_TABLE_ADDRESS should contain TTPT if positions are stored.
+const uint8_t positionEntrySize = 5;                // MSB -> LSB of the steps, then the flags.
+static_assert(POSITION_TABLE_SIZE <= 256, "POSITION_TABLE_SIZE must be no more than 256");
+#if defined(E2END)
+static_assert(POSITION_TABLE_ADDRESS + 4 + POSITION_TABLE_SIZE * 5 <= E2END + 1, "POSITION_TABLE_SIZE is too large for the EEPROM");
+#endif
+
+#if defined(PERSIST_POSITION)
+// The saved position is written to the next of POSITION_RECORD_SLOTS slots each time to spread the EEPROM wear.
+// Each slot is a sequence number, the state, MSB -> LSB of the stepper position and of lastStep, the phase, then
+// a CRC-8. The state is left out of the CRC so it can be marked moving with a single write.
+const uint8_t positionRecordSize = 12;
+#define POSITION_RECORD_IDLE 0x5A                   // Written last, once the rest of the record is complete.
+#define POSITION_RECORD_MOVING 0x00                 // Written before the turntable moves from the saved position.
+static uint8_t positionRecordSlot = 0;              // Slot holding the newest record.
+static uint8_t positionRecordSequence = 0;          // Sequence number of the newest record.
+static_assert(POSITION_RECORD_SLOTS >= 1 && POSITION_RECORD_SLOTS <= 64, "POSITION_RECORD_SLOTS must be from 1 to 64");
+#if defined(E2END)
+static_assert(POSITION_RECORD_ADDRESS + POSITION_RECORD_SLOTS * 12 <= E2END + 1, "POSITION_RECORD_SLOTS is too large for the EEPROM");
+#endif
+#endif
 
 // Function to retrieve step count from EEPROM.
 // Looks for identifier "TTEX" at 0 to 3.
@@ -41,29 +62,21 @@ long getSteps() {
   }
   uint8_t version = EEPROM.read(4);
   if (version != eepromVersion) {
-    Serial.println(F("EEPROM version outdated, calibration required"));
+    LOG_INFO(EEPROM_OUTDATED);
     stepsSet = false;
   }
   if (stepsSet) {
     eepromSteps = ((long)EEPROM.read(5) << 24) + ((long)EEPROM.read(6) << 16) + ((long)EEPROM.read(7) << 8) + (long)EEPROM.read(8);
     if (eepromSteps <= sanitySteps) {
-      if (debug) {
-        Serial.print(F("DEBUG: TTEX steps defined in EEPROM: "));
-        Serial.println(eepromSteps);
-      }
+      LOG_DEBUG(EEPROM_STEPS, eepromSteps);
       return eepromSteps;
     } else {
-      if (debug) {
-        Serial.print(F("DEBUG: TTEX steps defined in EEPROM are invalid: "));
-        Serial.println(eepromSteps);
-      }
+      LOG_DEBUG(EEPROM_STEPS_INVALID, eepromSteps);
       calibrating = true;
       return 0;
     }
   } else {
-    if (debug) {
-      Serial.println(F("DEBUG: TTEX steps not defined in EEPROM"));
-    }
+    LOG_DEBUG(EEPROM_STEPS_UNSET);
     calibrating = true;
     return 0;
   }
@@ -88,3 +101,133 @@ void clearEEPROM() {
     EEPROM.write(i, 0);
   }
 }
+
+// Function to check if the position table has been written.
+// Looks for identifier "TTPT" at POSITION_TABLE_ADDRESS, followed by the entries.
+static bool positionTableSet() {
+  for (uint8_t i = 0; i < 4; i++) {
+    if (EEPROM.read(POSITION_TABLE_ADDRESS + i) != positionTableFlag[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Function to retrieve a stored position, returns false if it isn't set.
+bool getStoredPosition(uint8_t index, long &steps, uint8_t &flags) {
+  if (index >= POSITION_TABLE_SIZE || !positionTableSet()) {
+    return false;
+  }
+  int address = POSITION_TABLE_ADDRESS + 4 + index * positionEntrySize;
+  steps = (int32_t)(((uint32_t)EEPROM.read(address) << 24) + ((uint32_t)EEPROM.read(address + 1) << 16) + ((uint16_t)EEPROM.read(address + 2) << 8) + EEPROM.read(address + 3));
+  flags = EEPROM.read(address + 4);
+  return steps >= 0;
+}
+
+// Function to store a position, a negative step count clears it. Returns false if the index is out of range.
+bool storePosition(uint8_t index, long steps, uint8_t flags) {
+  if (index >= POSITION_TABLE_SIZE) {
+    return false;
+  }
+  if (!positionTableSet()) {
+    // Clear every entry before first use, as the EEPROM may hold anything.
+    for (int address = POSITION_TABLE_ADDRESS + 4; address < POSITION_TABLE_ADDRESS + 4 + POSITION_TABLE_SIZE * positionEntrySize; address++) {
+      EEPROM.write(address, 0xFF);
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+      EEPROM.write(POSITION_TABLE_ADDRESS + i, positionTableFlag[i]);
+    }
+  }
+  if (steps < 0) {
+    steps = -1;
+  }
+  int address = POSITION_TABLE_ADDRESS + 4 + index * positionEntrySize;
+  EEPROM.write(address, (steps >> 24) & 0xFF);
+  EEPROM.write(address + 1, (steps >> 16) & 0xFF);
+  EEPROM.write(address + 2, (steps >> 8) & 0xFF);
+  EEPROM.write(address + 3, steps & 0xFF);
+  EEPROM.write(address + 4, flags);
+  return true;
+}
+
+#if defined(PERSIST_POSITION)
+// Function to write a byte only if it has changed, saving EEPROM wear and time.
+static void updateEEPROM(int address, uint8_t value) {
+  if (EEPROM.read(address) != value) {
+    EEPROM.write(address, value);
+  }
+}
+
+static int positionRecordAddress(uint8_t slot) {
+  return POSITION_RECORD_ADDRESS + slot * positionRecordSize;
+}
+
+// Function to calculate the CRC of a position record. This includes the step count and EEPROM version, so a
+// record saved before the turntable was calibrated again isn't used.
+static uint8_t positionRecordCRC(int address) {
+  uint8_t data[positionRecordSize - 2 + 5];
+  uint8_t length = 0;
+  data[length++] = EEPROM.read(address);
+  for (uint8_t i = 2; i < positionRecordSize - 1; i++) {
+    data[length++] = EEPROM.read(address + i);
+  }
+  data[length++] = (fullTurnSteps >> 24) & 0xFF;
+  data[length++] = (fullTurnSteps >> 16) & 0xFF;
+  data[length++] = (fullTurnSteps >> 8) & 0xFF;
+  data[length++] = fullTurnSteps & 0xFF;
+  data[length++] = eepromVersion;
+  return crc8(data, length);
+}
+
+// Function to find the newest position record, returns false if there isn't one or the turntable was moving.
+bool getPositionRecord(long &position, long &step, uint8_t &phase) {
+  bool found = false;
+  for (uint8_t slot = 0; slot < POSITION_RECORD_SLOTS; slot++) {
+    int address = positionRecordAddress(slot);
+    if (EEPROM.read(address + positionRecordSize - 1) != positionRecordCRC(address)) {
+      continue;
+    }
+    uint8_t sequence = EEPROM.read(address);
+    if (!found || (int8_t)(sequence - positionRecordSequence) > 0) {
+      found = true;
+      positionRecordSlot = slot;
+      positionRecordSequence = sequence;
+    }
+  }
+  int address = positionRecordAddress(positionRecordSlot);
+  if (!found || EEPROM.read(address + 1) != POSITION_RECORD_IDLE) {
+    return false;
+  }
+  position = (int32_t)(((uint32_t)EEPROM.read(address + 2) << 24) + ((uint32_t)EEPROM.read(address + 3) << 16) + ((uint16_t)EEPROM.read(address + 4) << 8) + EEPROM.read(address + 5));
+  step = (int32_t)(((uint32_t)EEPROM.read(address + 6) << 24) + ((uint32_t)EEPROM.read(address + 7) << 16) + ((uint16_t)EEPROM.read(address + 8) << 8) + EEPROM.read(address + 9));
+  phase = EEPROM.read(address + 10);
+  return true;
+}
+
+// Function to mark the newest position record as out of date, before the turntable moves.
+void markPositionMoving() {
+  updateEEPROM(positionRecordAddress(positionRecordSlot) + 1, POSITION_RECORD_MOVING);
+}
+
+// Function to save the position in the next slot. If power is lost part way through, the record isn't complete
+// and the previous one is already marked as out of date, so the turntable homes.
+void writePositionRecord(long position, long step, uint8_t phase) {
+  markPositionMoving();
+  positionRecordSlot = (positionRecordSlot + 1) % POSITION_RECORD_SLOTS;
+  positionRecordSequence++;
+  int address = positionRecordAddress(positionRecordSlot);
+  updateEEPROM(address + 1, POSITION_RECORD_MOVING);
+  updateEEPROM(address, positionRecordSequence);
+  updateEEPROM(address + 2, (position >> 24) & 0xFF);
+  updateEEPROM(address + 3, (position >> 16) & 0xFF);
+  updateEEPROM(address + 4, (position >> 8) & 0xFF);
+  updateEEPROM(address + 5, position & 0xFF);
+  updateEEPROM(address + 6, (step >> 24) & 0xFF);
+  updateEEPROM(address + 7, (step >> 16) & 0xFF);
+  updateEEPROM(address + 8, (step >> 8) & 0xFF);
+  updateEEPROM(address + 9, step & 0xFF);
+  updateEEPROM(address + 10, phase);
+  updateEEPROM(address + positionRecordSize - 1, positionRecordCRC(address));
+  updateEEPROM(address + 1, POSITION_RECORD_IDLE);
+}
+#endif
@@ -27,5 +27,12 @@
 long getSteps();
 void writeEEPROM(long steps);
 void clearEEPROM();
+bool getStoredPosition(uint8_t index, long &steps, uint8_t &flags);
+bool storePosition(uint8_t index, long steps, uint8_t flags);
+#if defined(PERSIST_POSITION)
+bool getPositionRecord(long &position, long &step, uint8_t &phase);
+void markPositionMoving();
+void writePositionRecord(long position, long step, uint8_t phase);
+#endif
 
 #endif
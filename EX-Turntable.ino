@@ -25,6 +25,7 @@
 // Include local files
 #include "IOFunctions.h"
 #include "TurntableFunctions.h"
+#include "DCCFunctions.h"
 
 bool lastRunningState;   // Stores last running state to allow turning the stepper off after moves.
 
@@ -38,40 +39,45 @@ void setup() {
   // If we're not sensor testing, start Wire()
   if (!sensorTesting) setupWire();
 
+#if defined(DCC_ACCESSORY_ADDRESS)
+  // If we're not sensor testing, start the DCC decoder
+  if (!sensorTesting) setupDCC();
+#endif
+
   // Display EX-Turntable configuration
   displayTTEXConfig();
 }
 
 void loop() {
+// Sample the home and limit sensors when due.
+  processSensors();
+
 // If we're only testing sensors, don't do anything else.
   if (sensorTesting) {
-    bool testHomeSensorState = getHomeState();
-    if (testHomeSensorState != homeSensorState) {
-      if (testHomeSensorState == HOME_SENSOR_ACTIVE_STATE) {
+    uint8_t sensorChanges = getSensorChanges();
+    if (sensorChanges & SENSOR_HOME) {
+      if (getHomeState() == HOME_SENSOR_ACTIVE_STATE) {
         Serial.println(F("Home sensor ACTIVATED"));
       } else {
         Serial.println(F("Home sensor DEACTIVATED"));
       }
-      homeSensorState = testHomeSensorState;
     }
-    getHomeState();
 
 #if TURNTABLE_EX_MODE == TRAVERSER
-    bool testLimitSensorState = getLimitState();
-    if (testLimitSensorState != limitSensorState) {
-      if (testLimitSensorState == LIMIT_SENSOR_ACTIVE_STATE) {
+    if (sensorChanges & SENSOR_LIMIT) {
+      if (getLimitState() == LIMIT_SENSOR_ACTIVE_STATE) {
         Serial.println(F("Limit sensor ACTIVATED"));
       } else {
         Serial.println(F("Limit sensor DEACTIVATED"));
       }
-      limitSensorState = testLimitSensorState;
     }
 #endif
   } else {
 #if TURNTABLE_EX_MODE == TRAVERSER
 // If we hit our limit switch when not calibrating, stop!
     if (getLimitState() == LIMIT_SENSOR_ACTIVE_STATE && !calibrating && stepper.isRunning() && stepper.targetPosition() < 0) {
-      Serial.println(F("ALERT! Limit sensor activitated, halting stepper"));
+      LOG_ERROR(LIMIT_SENSOR_ALERT);
+      turntableError = TURNTABLE_ERROR_LIMIT_REACHED;
       if (!homed) {
         homed = 1;
       }
@@ -81,12 +87,21 @@ void loop() {
 
 // If we hit our home switch when not homing, stop!
     if (getHomeState() == HOME_SENSOR_ACTIVE_STATE && homed && !calibrating && stepper.isRunning() && stepper.distanceToGo() > 0) {
-      Serial.println(F("ALERT! Home sensor activitated, halting stepper"));
+      LOG_ERROR(HOME_SENSOR_ALERT);
+      long offset = getHomeOffset();
       stepper.stop();
-      stepper.setCurrentPosition(0);
+      stepper.setCurrentPosition(offset);
     }
 #endif
 
+#if defined(DCC_ACCESSORY_ADDRESS)
+// Act on any DCC accessory commands received.
+    processDCC();
+#endif
+
+// Execute any commands received via I2C.
+    processCommandQueue();
+
 // If we haven't successfully homed yet, do it.
     if (homed == 0) {
       moveHome();
@@ -97,12 +112,20 @@ void loop() {
       calibration();
     }
 
+#if defined(PERSIST_POSITION)
+// Keep the position saved in EEPROM up to date before the stepper starts any new move.
+    processPositionRecord();
+#endif
+
 // Process the stepper object continuously.
     stepper.run();
 
 // Process our LED.
     processLED();
 
+// Refresh the status sent in reply to I2C reads.
+    updateStatusFrame();
+
 // If disabling on idle is enabled, disable the stepper.
 #if defined(DISABLE_OUTPUTS_IDLE)
     if (stepper.isRunning() != lastRunningState) {
@@ -113,6 +136,12 @@ void loop() {
     }
 #endif
   }
+  // Send telemetry if it's been turned on with <W>.
+  processTelemetry();
+
+  // Send what's been logged, as far as the serial port can take it without waiting.
+  processLog();
+
   // Receive and process and serial input for test commands.
   processSerialInput();
 }
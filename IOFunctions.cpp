@@ -25,13 +25,61 @@
 #endif
 
 unsigned long gearingFactor = STEPPER_GEARING_FACTOR;
-const byte numChars = 20;
-char serialInputChars[numChars];
-bool newSerialData = false;
-bool testCommandSent = false;
-uint8_t testActivity = 0;
-uint8_t testStepsMSB = 0;
-uint8_t testStepsLSB = 0;
+#define I2C_RECEIVE_SIZE 32                 // Longest I2C transmission, the Wire library buffer size.
+#define SERIAL_MAX_PARAMETERS 4             // Most numbers accepted after a serial command letter.
+
+// Serial commands are parsed a byte at a time as they arrive, processSerialInput() keeps its progress here.
+#define SERIAL_WAITING 0                    // Ignoring input until the next '<'.
+#define SERIAL_COMMAND 1                    // Expecting the command letter.
+#define SERIAL_PARAMETERS 2                 // Collecting numbers until '>'.
+static uint8_t serialState = SERIAL_WAITING;
+static char serialCommand;
+static long serialValues[SERIAL_MAX_PARAMETERS];
+static uint8_t serialParameters;
+static bool serialInNumber;
+static bool serialNegative;
+static bool serialError;
+
+// Commands received by receiveEvent() are queued here for processCommandQueue() to execute in loop().
+// The I2C interrupt only writes commandQueueHead and the main loop only writes commandQueueTail, both
+// run freely and wrap, so no locking is needed.
+#define COMMAND_GEARED_MOVE 0                   // Original 16 bit command, steps are multiplied by the gearing factor.
+#define COMMAND_MOVE 1                          // Full step position.
+#define COMMAND_POSITION 2                      // Move to the stored position indexed by steps.
+struct I2CCommand {
+  int32_t steps;
+  uint8_t activity;
+  uint8_t type;
+};
+static_assert((I2C_COMMAND_QUEUE_SIZE & (I2C_COMMAND_QUEUE_SIZE - 1)) == 0 && I2C_COMMAND_QUEUE_SIZE <= 128,
+              "I2C_COMMAND_QUEUE_SIZE must be a power of 2 no larger than 128");
+volatile I2CCommand commandQueue[I2C_COMMAND_QUEUE_SIZE];
+volatile uint8_t commandQueueHead = 0;      // Next entry to write, updated by receiveEvent().
+volatile uint8_t commandQueueTail = 0;      // Next entry to execute, updated by processCommandQueue().
+volatile uint8_t commandQueueHighWater = 0; // Most commands waiting at once.
+volatile uint16_t commandsDropped = 0;      // Commands discarded as the queue was full.
+volatile uint16_t commandsInvalid = 0;      // Transmissions discarded as they weren't a valid command.
+volatile uint16_t commandsCorrupt = 0;      // Framed commands discarded for a bad CRC.
+volatile uint16_t commandsDuplicate = 0;    // Framed commands ignored as they repeated the last sequence number.
+volatile uint8_t lastSequence = 0;          // Sequence number of the last framed command acted on.
+volatile bool sequenceReceived = false;     // Set once lastSequence is valid.
+
+// Reads are answered by requestEvent() from this frame, which loop() keeps up to date with updateStatusFrame().
+volatile uint8_t i2cStatusMode = I2C_STATUS_BASIC;
+volatile uint8_t statusFrame[I2C_STATUS_FRAME_SIZE];
+uint8_t statusChangeCount = 0;
+
+// Registers are read from registers, kept up to date by updateStatusFrame(). Writes are held in registerWrites
+// by receiveEvent(), with a bit set in registersWritten for each, until processRegisterWrites() applies them.
+volatile uint16_t registers[I2C_REGISTER_COUNT];
+volatile uint16_t registerWrites[I2C_REGISTER_COUNT];
+volatile uint16_t registersWritten = 0;
+volatile uint8_t registerPointer = 0;
+static_assert(I2C_REGISTER_COUNT <= 16, "registersWritten needs a bit for every register");
+
+#if defined(ATTENTION_PIN)
+volatile bool attention = false;            // ATTENTION_PIN is pulled low until the status is read.
+#endif
 #ifdef DEBUG
 bool debug = true;
 #else
@@ -53,85 +101,180 @@ void setupWire() {
 #endif
   Wire.onReceive(receiveEvent);
   Wire.onRequest(requestEvent);
+#if defined(ATTENTION_PIN)
+  setAttention(false);
+#endif
+}
+
+#if defined(ATTENTION_PIN)
+// Function to pull the open drain ATTENTION_PIN low, or release it.
+void setAttention(bool state) {
+  attention = state;
+  if (state) {
+    digitalWrite(ATTENTION_PIN, LOW);
+    pinMode(ATTENTION_PIN, OUTPUT);
+  } else {
+    pinMode(ATTENTION_PIN, INPUT);
+    digitalWrite(ATTENTION_PIN, LOW);
+  }
 }
+#endif
+
+// Function to run a complete serial command.
+static void runSerialCommand(char command, uint8_t parameters, long *values) {
+  switch (command) {
+    case 'B':
+      serialCommandB();
+      break;
+
+    case 'C':
+      serialCommandC();
+      break;
+    
+    case 'D':
+      serialCommandD();
+      break;
+    
+    case 'E':
+      serialCommandE();
+      break;
+
+    case 'H':
+      serialCommandH();
+      break;
+    
+    case 'L':
+      serialCommandL();
+      break;
+
+    case 'M':
+      if (parameters == 0) {
+        Serial.println(F("<X>"));
+      } else {
+        serialCommandM(values[0], parameters > 1 ? values[1] : 0);
+      }
+      break;
+
+    case 'N':
+      serialCommandN();
+      break;
+
+    case 'P':
+      serialCommandP(parameters, values);
+      break;
+
+    case 'Q':
+      serialCommandQ();
+      break;
+
+    case 'R':
+      serialCommandR();
+      break;
+
+    case 'S':
+      serialCommandS();
+      break;
+
+    case 'T':
+      serialCommandT();
+      break;
+
+    case 'V':
+      serialCommandV();
+      break;
 
-// Function to read and process serial input for valid test commands
+    case 'W':
+      serialCommandW(parameters, values);
+      break;
+
+    default:
+      Serial.println(F("<X>"));
+      break;
+  }
+}
+
+// Function to finish the number in progress, if any.
+static void endSerialNumber() {
+  if (!serialInNumber) return;
+  serialInNumber = false;
+  if (serialParameters >= SERIAL_MAX_PARAMETERS) {
+    serialError = true;
+    return;
+  }
+  if (serialNegative) serialValues[serialParameters] = -serialValues[serialParameters];
+  serialParameters++;
+}
+
+// Function to parse serial input a byte at a time, commands are <C n n ...> with C a single letter and up to
+// SERIAL_MAX_PARAMETERS signed numbers. Anything malformed is answered with <X> rather than guessed at.
+// At most one command is run per call so the stepper isn't held up by a burst of input.
 void processSerialInput() {
-  static bool serialInProgress = false;
-  static byte serialIndex = 0;
-  char startMarker = '<';
-  char endMarker = '>';
-  char serialChar;
-  while (Serial.available() > 0 && newSerialData == false) {
-    serialChar = Serial.read();
-    if (serialInProgress == true) {
-      if (serialChar != endMarker) {
-        serialInputChars[serialIndex] = serialChar;
-        serialIndex++;
-        if (serialIndex >= numChars) {
-          serialIndex = numChars - 1;
-        }
+  while (Serial.available() > 0) {
+    char serialChar = Serial.read();
+    if (serialChar == '<') {
+      // Always start again, so a lost '>' only costs the command it belonged to.
+      serialState = SERIAL_COMMAND;
+      serialCommand = 0;
+      serialParameters = 0;
+      serialInNumber = false;
+      serialError = false;
+      continue;
+    }
+    if (serialState == SERIAL_WAITING) continue;
+    if (serialChar == '>') {
+      endSerialNumber();
+      serialState = SERIAL_WAITING;
+      // Replies are printed directly, so send anything already logged first.
+      flushLog();
+      if (serialError || serialCommand == 0) {
+        Serial.println(F("<X>"));
       } else {
-        serialInputChars[serialIndex] = '\0';
-        serialInProgress = false;
-        serialIndex = 0;
-        newSerialData = true;
+        runSerialCommand(serialCommand, serialParameters, serialValues);
       }
-    } else if (serialChar == startMarker) {
-      serialInProgress = true;
+      return;
     }
-  }
-  if (newSerialData == true) {
-    newSerialData = false;
-    char * strtokIndex;
-    strtokIndex = strtok(serialInputChars," ");
-    char command = strtokIndex[0];     // first parameter is activity
-    strtokIndex = strtok(NULL," ");     // space separator
-    long steps;
-    if (command == 'M') {
-      steps = atol(strtokIndex);
-      strtokIndex = strtok(NULL," ");
-      testActivity = atoi(strtokIndex);
+    if (serialState == SERIAL_COMMAND) {
+      if (serialChar == ' ') continue;
+      serialCommand = serialChar;
+      serialState = SERIAL_PARAMETERS;
+      continue;
     }
-    switch (command) {
-      case 'C':
-        serialCommandC();
-        break;
-      
-      case 'D':
-        serialCommandD();
-        break;
-      
-      case 'E':
-        serialCommandE();
-        break;
-
-      case 'H':
-        serialCommandH();
-        break;
-      
-      case 'M':
-        serialCommandM(steps);
-        break;
-
-      case 'R':
-        serialCommandR();
-        break;
-
-      case 'T':
-        serialCommandT();
-        break;
-
-      case 'V':
-        serialCommandV();
-        break;
-
-      default:
-        break;
+    if (serialChar == ' ' || serialChar == '\r' || serialChar == '\n') {
+      endSerialNumber();
+    } else if (serialChar == '-' && !serialInNumber) {
+      serialInNumber = true;
+      serialNegative = true;
+      if (serialParameters < SERIAL_MAX_PARAMETERS) serialValues[serialParameters] = 0;
+    } else if (serialChar >= '0' && serialChar <= '9') {
+      if (!serialInNumber) {
+        serialInNumber = true;
+        serialNegative = false;
+        if (serialParameters < SERIAL_MAX_PARAMETERS) serialValues[serialParameters] = 0;
+      }
+      if (serialParameters < SERIAL_MAX_PARAMETERS) {
+        if (serialValues[serialParameters] > 214748363L) {
+          // Beyond a 32 bit step count.
+          serialError = true;
+        } else {
+          serialValues[serialParameters] = serialValues[serialParameters] * 10 + (serialChar - '0');
+        }
+      }
+    } else {
+      serialError = true;
     }
   }
 }
 
+// B command to benchmark the acceleration ramp engines
+void serialCommandB() {
+  if (stepper.isRunning()) {
+    Serial.println(F("Stepper is running, ignoring <B>"));
+    return;
+  }
+  Serial.println(F("Benchmarking acceleration ramp engines"));
+  benchmarkRampEngines();
+}
+
 // C command to initiate calibration
 void serialCommandC() {
   if (stepper.isRunning()) {
@@ -145,6 +288,9 @@ void serialCommandC() {
 
 // D command to enable debug output
 void serialCommandD() {
+#if LOG_LEVEL < LOG_LEVEL_DEBUG
+  Serial.println(F("Debug output is not included, LOG_LEVEL must be LOG_LEVEL_DEBUG"));
+#else
   if (debug) {
     Serial.println(F("Disabling debug output"));
     debug = false;
@@ -152,6 +298,7 @@ void serialCommandD() {
     Serial.println(F("Enabling debug output"));
     debug = true;
   }
+#endif
 }
 
 // E command to erase EEPROM
@@ -179,28 +326,165 @@ void serialCommandH() {
   }
 }
 
+// L command to display how late steps have been since the last <L>
+void serialCommandL() {
+#if defined(STEPPER_TIMER_INTERRUPT)
+  Serial.println(F("Steps are timed by the timer interrupt, lateness is not measured"));
+#else
+  Serial.print(F("Step lateness over "));
+  Serial.print(stepper.latenessCount());
+  Serial.print(F(" steps, max "));
+  Serial.print(stepper.maxLateness());
+  Serial.print(F("us, mean "));
+  Serial.print(stepper.meanLateness());
+  Serial.println(F("us"));
+  stepper.resetLateness();
+#endif
+}
+
 // M command to move
-void serialCommandM(long steps) {
+void serialCommandM(long steps, long activity) {
   if (stepper.isRunning()) {
     Serial.println(F("Stepper is running, ignoring <M>"));
     return;
   }
   if (steps < 0) {
     Serial.println(F("Cannot provide a negative step count"));
-  } else if (steps > 32767) {
-    Serial.println(F("Step count too large, refer to the documentation for large step counts > 32767"));
+  } else if (activity < 0 || activity > 255) {
+    Serial.println(F("Activity must be 0 to 255"));
   } else {
     Serial.print(F("Test move "));
     Serial.print(steps);
     Serial.print(F(" steps, activity ID "));
-    Serial.println(testActivity);
-    testStepsMSB = steps >> 8;
-    testStepsLSB = steps & 0xFF;
-    testCommandSent = true;
-    receiveEvent(3);
+    Serial.println(activity);
+    processCommand(steps, activity);
+  }
+}
+
+// N command to display the I2C command queue statistics in a machine readable form:
+// <n queueSize highWater dropped invalid corrupt duplicate logDropped>
+void serialCommandN() {
+#ifndef ESP32
+  noInterrupts();
+#endif
+  uint8_t highWater = commandQueueHighWater;
+  uint16_t dropped = commandsDropped;
+  uint16_t invalid = commandsInvalid;
+  uint16_t corrupt = commandsCorrupt;
+  uint16_t duplicate = commandsDuplicate;
+#ifndef ESP32
+  interrupts();
+#endif
+  Serial.print(F("<n "));
+  Serial.print(I2C_COMMAND_QUEUE_SIZE);
+  Serial.print(F(" "));
+  Serial.print(highWater);
+  Serial.print(F(" "));
+  Serial.print(dropped);
+  Serial.print(F(" "));
+  Serial.print(invalid);
+  Serial.print(F(" "));
+  Serial.print(corrupt);
+  Serial.print(F(" "));
+  Serial.print(duplicate);
+  Serial.print(F(" "));
+  Serial.print(logDropped);
+  Serial.println(F(">"));
+}
+
+// P command to list, store, or move to stored positions:
+// <P> lists them, <P index> moves to one, <P index steps [phase] [direction]> stores one, <P index -1> clears one.
+void serialCommandP(uint8_t parameters, long *values) {
+  long steps;
+  uint8_t flags;
+  if (parameters == 0) {
+    for (uint16_t index = 0; index < POSITION_TABLE_SIZE; index++) {
+      if (getStoredPosition(index, steps, flags)) {
+        Serial.print(F("Position "));
+        Serial.print(index);
+        Serial.print(F(": "));
+        Serial.print(steps);
+        Serial.print(F(" steps, phase "));
+        Serial.print(flags & POSITION_FLAG_PHASE);
+        Serial.print(F(", direction "));
+        Serial.println((flags & POSITION_FLAG_DIRECTION) >> 1);
+      }
+    }
+    return;
+  }
+  if (values[0] < 0 || values[0] >= POSITION_TABLE_SIZE) {
+    Serial.print(F("Position index must be 0 to "));
+    Serial.println(POSITION_TABLE_SIZE - 1);
+    return;
+  }
+  if (parameters == 1) {
+    if (stepper.isRunning()) {
+      Serial.println(F("Stepper is running, ignoring <P>"));
+      return;
+    }
+    if (!getStoredPosition(values[0], steps, flags)) {
+      Serial.println(F("Position has not been stored"));
+      return;
+    }
+    processPositionCommand(values[0]);
+    return;
+  }
+  steps = values[1];
+  long phase = parameters > 2 ? values[2] : 0;
+  long direction = parameters > 3 ? values[3] : ROTATE_DEFAULT;
+  // Check the full values, so out of range ones can't wrap into range when stored as bytes.
+  if (phase < 0 || phase > 1 || direction < 0 || direction > ROTATE_REVERSE || (steps > fullTurnSteps && fullTurnSteps > 0)) {
+    Serial.println(F("Invalid position, steps must be within a full turn, phase 0 or 1, and direction 0 to 2"));
+    return;
+  }
+  storePosition(values[0], steps, phase | (direction << 1));
+  Serial.print(F("Position "));
+  Serial.print(values[0]);
+  if (steps < 0) {
+    Serial.println(F(" cleared"));
+  } else {
+    Serial.println(F(" stored"));
   }
 }
 
+// Q command to display the I2C command queue statistics
+void serialCommandQ() {
+  // The counters are updated by the I2C interrupt, so take a consistent copy.
+#ifndef ESP32
+  noInterrupts();
+#endif
+  uint8_t highWater = commandQueueHighWater;
+  uint16_t dropped = commandsDropped;
+  uint16_t invalid = commandsInvalid;
+  uint16_t corrupt = commandsCorrupt;
+  uint16_t duplicate = commandsDuplicate;
+#ifndef ESP32
+  interrupts();
+#endif
+  Serial.print(F("I2C command queue size "));
+  Serial.print(I2C_COMMAND_QUEUE_SIZE);
+  Serial.print(F(", high water mark "));
+  Serial.print(highWater);
+  Serial.print(F(", dropped "));
+  Serial.print(dropped);
+  Serial.print(F(", invalid "));
+  Serial.print(invalid);
+  Serial.print(F(", corrupt "));
+  Serial.print(corrupt);
+  Serial.print(F(", duplicate "));
+  Serial.print(duplicate);
+  Serial.print(F(", log messages dropped "));
+  Serial.print(logDropped);
+  if (i2cStatusMode == I2C_STATUS_REGISTERS) {
+    Serial.println(F(", register replies"));
+  } else if (i2cStatusMode == I2C_STATUS_EXTENDED) {
+    Serial.println(F(", extended status replies"));
+  } else {
+    Serial.println(F(", basic status replies"));
+  }
+}
+
+// R command to reboot
 void serialCommandR() {
 #ifndef ESP32
   wdt_enable(WDTO_15MS);
@@ -210,6 +494,32 @@ void serialCommandR() {
 #endif
 }
 
+// S command to display the status in a machine readable form, the same values as the extended I2C status frame
+// which loop() keeps up to date: <s state flags error changes position target speed>
+void serialCommandS() {
+  uint32_t position = 0;
+  uint32_t target = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    position = (position << 8) | statusFrame[5 + i];
+    target = (target << 8) | statusFrame[9 + i];
+  }
+  Serial.print(F("<s "));
+  Serial.print(statusFrame[1]);
+  Serial.print(F(" "));
+  Serial.print(statusFrame[2]);
+  Serial.print(F(" "));
+  Serial.print(statusFrame[3]);
+  Serial.print(F(" "));
+  Serial.print(statusFrame[4]);
+  Serial.print(F(" "));
+  Serial.print((long)(int32_t)position);
+  Serial.print(F(" "));
+  Serial.print((long)(int32_t)target);
+  Serial.print(F(" "));
+  Serial.print((long)stepper.speed());
+  Serial.println(F(">"));
+}
+
 // T command to perform sensor testing
 void serialCommandT() {
   if (stepper.isRunning()) {
@@ -231,11 +541,32 @@ void serialCommandV() {
   displayTTEXConfig();
 }
 
+// W command to stream telemetry samples of the position, speed and sensors as CSV lines for plotting:
+// <W> turns telemetry on or off, <W interval> sends it every interval ms, <W 0> turns it off.
+void serialCommandW(uint8_t parameters, long *values) {
+  long interval;
+  if (parameters > 0) {
+    interval = values[0];
+  } else {
+    interval = telemetryInterval ? 0 : TELEMETRY_INTERVAL;
+  }
+  setTelemetry(interval);
+  if (telemetryInterval) {
+    Serial.print(F("Telemetry every "));
+    Serial.print(telemetryInterval);
+    Serial.println(F("ms"));
+  } else {
+    Serial.println(F("Telemetry off"));
+  }
+}
+
 // Function to display the defined stepper motor config.
 void displayTTEXConfig() {
   // Basic setup, display what this is.
   Serial.begin(115200);
   while(!Serial);
+  // This is printed directly, so send anything already logged first.
+  flushLog();
   Serial.println(F("License GPLv3 fsf.org (c) dcc-ex.com"));
   Serial.print(F("EX-Turntable version "));
   Serial.println(VERSION);
@@ -294,144 +625,479 @@ void displayTTEXConfig() {
   Serial.println(STEPPER_MAX_SPEED);
   Serial.print(F("STEPPER_ACCELERATION "));
   Serial.println(STEPPER_ACCELERATION);
+#if STEPPER_RAMP_ENGINE == FIXED_RAMP
+  Serial.println(F("STEPPER_RAMP_ENGINE FIXED_RAMP"));
+#elif STEPPER_RAMP_ENGINE == TABLE_RAMP
+  Serial.print(F("STEPPER_RAMP_ENGINE TABLE_RAMP, STEPPER_RAMP_TABLE_SIZE "));
+  Serial.println(STEPPER_RAMP_TABLE_SIZE);
+#elif STEPPER_RAMP_ENGINE == SCURVE_RAMP
+  Serial.print(F("STEPPER_RAMP_ENGINE SCURVE_RAMP, STEPPER_JERK "));
+  Serial.println(STEPPER_JERK);
+#else
+  Serial.println(F("STEPPER_RAMP_ENGINE FLOAT_RAMP"));
+#endif
+#if defined(STEPPER_TIMER_INTERRUPT)
+  Serial.println(F("STEPPER_TIMER_INTERRUPT enabled"));
+#endif
+#if defined(STEPPER_NONBLOCKING_PULSE)
+  Serial.println(F("STEPPER_NONBLOCKING_PULSE enabled"));
+#endif
+#if defined(STEPPER_MAX_CATCH_UP)
+  Serial.print(F("STEPPER_MAX_CATCH_UP "));
+  Serial.println(STEPPER_MAX_CATCH_UP);
+#endif
+#if defined(DCC_ACCESSORY_ADDRESS)
+  Serial.print(F("DCC accessory decoder on pin "));
+  Serial.print(DCC_INPUT_PIN);
+  Serial.print(F(" at address "));
+  Serial.println(DCC_ACCESSORY_ADDRESS);
+#endif
+#if defined(ATTENTION_PIN)
+  Serial.print(F("ATTENTION_PIN "));
+  Serial.println(ATTENTION_PIN);
+#endif
 
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
   if (debug) {
     Serial.print(F("DEBUG: maxSpeed()|acceleration(): "));
     Serial.print(stepper.maxSpeed());
     Serial.print(F("|"));
     Serial.println(stepper.acceleration());
   }
+#endif
 
   // If in sensor testing mode, display this, don't enable stepper or I2C
   if (sensorTesting) {
     Serial.println(F("SENSOR TESTING ENABLED, EX-Turntable operations disabled"));
     Serial.print(F("Home/limit switch current state: "));
-    Serial.print(homeSensorState);
+    Serial.print(getHomeState());
     Serial.print(F("/"));
-    Serial.println(limitSensorState);
+    Serial.println(getLimitState());
     Serial.print(F("Debounce delay: "));
-    Serial.println(DEBOUNCE_DELAY);
+    Serial.print(DEBOUNCE_DELAY);
+    Serial.print(F("ms, sensor filter: "));
+    Serial.print(SENSOR_FILTER_SAMPLES);
+    Serial.print(F(" samples every "));
+    Serial.print(SENSOR_SAMPLE_INTERVAL);
+    Serial.println(F("us"));
   }
 }
 
-// Function to define the action on a received I2C event.
-void receiveEvent(int received) {
-  if (debug) {
-    Serial.print(F("DEBUG: Received "));
-    Serial.print(received);
-    Serial.println(F(" bytes"));
+// CRC-8 of the SMBus polynomial x^8 + x^2 + x + 1 for each value of the top nibble.
+static const uint8_t crc8Table[16] PROGMEM = {
+  0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+// Function to calculate the CRC-8 of a framed command or EEPROM record, a nibble at a time to keep the interrupt short.
+uint8_t crc8(const uint8_t *data, uint8_t length) {
+  uint8_t crc = 0;
+  while (length--) {
+    crc ^= *data++;
+    crc = (crc << 4) ^ pgm_read_byte(&crc8Table[crc >> 4]);
+    crc = (crc << 4) ^ pgm_read_byte(&crc8Table[crc >> 4]);
   }
-  int16_t receivedSteps;
-  long steps;  
-  uint8_t activity;
-  uint8_t receivedStepsMSB;
-  uint8_t receivedStepsLSB;
-  // We need 3 received bytes in order to care about what's received.
-  if (received == 3) {
-    // Get our 3 bytes of data, bit shift into steps.
-    if (testCommandSent == true) {
-      receivedStepsMSB = testStepsMSB;
-      receivedStepsLSB = testStepsLSB;
-      activity = testActivity;
-      testCommandSent = false;
-    } else {
-      receivedStepsMSB = Wire.read();
-      receivedStepsLSB = Wire.read();
-      activity = Wire.read();
+  return crc;
+}
+
+// Function to check the command queue has room for count commands, counting them as dropped if not.
+static bool reserveCommands(uint8_t count) {
+  if ((uint8_t)(commandQueueHead - commandQueueTail) + count > I2C_COMMAND_QUEUE_SIZE) {
+    commandsDropped++;
+    return false;
+  }
+  return true;
+}
+
+// Function to get a reserved command queue entry, index 0 being the first.
+static volatile I2CCommand &reservedCommand(uint8_t index) {
+  return commandQueue[(uint8_t)(commandQueueHead + index) & (I2C_COMMAND_QUEUE_SIZE - 1)];
+}
+
+// Function to make the reserved entries visible to processCommandQueue() once they're complete.
+static void queueCommands(uint8_t count) {
+  uint8_t head = commandQueueHead + count;
+  commandQueueHead = head;
+  uint8_t waiting = head - commandQueueTail;
+  if (waiting > commandQueueHighWater) {
+    commandQueueHighWater = waiting;
+  }
+}
+
+// Function to read an original format <steps MSB, steps LSB, activity> command.
+static void readGearedCommand(volatile I2CCommand &command, const uint8_t *data) {
+  command.steps = (int16_t)((data[0] << 8) | data[1]);
+  command.activity = data[2];
+  command.type = COMMAND_GEARED_MOVE;
+}
+
+// Function to act on a received command, returns false if it isn't valid.
+static bool receiveCommand(const uint8_t *data, uint8_t length) {
+  // The original move command is always 3 bytes, anything else is an extended command.
+  if (length == 3) {
+    if (reserveCommands(1)) {
+      readGearedCommand(reservedCommand(0), data);
+      queueCommands(1);
     }
-    receivedSteps = (receivedStepsMSB << 8) + receivedStepsLSB;
-    if (gearingFactor > 10) {
-      gearingFactor = 10;
+    return true;
+  }
+  if (length < 2) {
+    return false;
+  }
+  uint8_t command = data[0];
+  if (command == I2C_COMMAND_STATUS_MODE && length == 2) {
+    // Only changes how we reply, so handled immediately.
+    if (data[1] == I2C_STATUS_BASIC || data[1] == I2C_STATUS_EXTENDED) {
+      i2cStatusMode = data[1];
+      return true;
     }
-    steps = receivedSteps * gearingFactor;
-    if (debug) {
-      Serial.print(F("DEBUG: receivedStepsMSB|receivedStepsLSB|activity: "));
-      Serial.print(receivedStepsMSB);
-      Serial.print(F("|"));
-      Serial.print(receivedStepsLSB);
-      Serial.print(F("|"));
-      Serial.println(activity);
-      Serial.print(F("DEBUG: gearingFactor|receivedSteps|steps: "));
-      Serial.print(gearingFactor);
-      Serial.print(F("|"));
-      Serial.print(receivedSteps);
-      Serial.print(F("|"));
-      Serial.println(steps);
+  } else if (command == I2C_COMMAND_MOVE && length == 6) {
+    if (reserveCommands(1)) {
+      volatile I2CCommand &entry = reservedCommand(0);
+      entry.steps = (int32_t)(((uint32_t)data[1] << 24) | ((uint32_t)data[2] << 16) | ((uint16_t)data[3] << 8) | data[4]);
+      entry.activity = data[5];
+      entry.type = COMMAND_MOVE;
+      queueCommands(1);
     }
-    if (steps <= fullTurnSteps && activity < 2 && !stepper.isRunning() && !calibrating) {
-      // Activities 0/1 require turning and setting phase, process only if stepper is not running.
-      if (debug) {
-        Serial.print(F("DEBUG: Requested valid step move to: "));
-        Serial.print(steps);
-        Serial.print(F(" with phase switch: "));
-        Serial.println(activity);
-      }
-      moveToPosition(steps, activity);
-    } else if (activity == 2 && !stepper.isRunning() && (!calibrating || homed == 2)) {
-      // Activity 2 needs to reset our homed flag to initiate the homing process, only if stepper not running.
-      if (debug) {
-        Serial.println(F("DEBUG: Requested to home"));
-      }
-      initiateHoming();
-    } else if (activity == 3 && !stepper.isRunning() && (!calibrating || homed == 2)) {
-      // Activity 3 will initiate calibration sequence, only if stepper not running.
-      if (debug) {
-        Serial.println(F("DEBUG: Calibration requested"));
-      }
-      initiateCalibration();
-    } else if (activity > 3 && activity < 8) {
-      // Activities 4 through 7 set LED state.
-      if (debug) {
-        Serial.print(F("DEBUG: Set LED state to: "));
-        Serial.println(activity);
-      }
-      setLEDActivity(activity);
-    } else if (activity == 8) {
-      // Activity 8 turns accessory pin on at any time.
-      if (debug) {
-        Serial.println(F("DEBUG: Turn accessory pin on"));
+    return true;
+  } else if (command == I2C_COMMAND_POSITION && length == 2) {
+    if (reserveCommands(1)) {
+      volatile I2CCommand &entry = reservedCommand(0);
+      entry.steps = data[1];
+      entry.activity = 0;
+      entry.type = COMMAND_POSITION;
+      queueCommands(1);
+    }
+    return true;
+  } else if (command == I2C_COMMAND_BATCH && (length - 1) % 3 == 0) {
+    // Queue all the commands at once, so they're executed in order in the same pass through loop().
+    uint8_t count = (length - 1) / 3;
+    if (reserveCommands(count)) {
+      for (uint8_t i = 0; i < count; i++) {
+        readGearedCommand(reservedCommand(i), data + 1 + i * 3);
       }
-      setAccessory(HIGH);
-    } else if (activity == 9) {
-      // Activity 9 turns accessory pin off at any time.
-      if (debug) {
-        Serial.println(F("DEBUG: Turn accessory pin off"));
+      queueCommands(count);
+    }
+    return true;
+  } else if (command == I2C_COMMAND_REGISTERS && length % 2 == 0 && data[1] < I2C_REGISTER_COUNT) {
+    // Select the register for following reads, then write any values to it and the registers after it.
+    uint8_t reg = data[1];
+    registerPointer = reg;
+    i2cStatusMode = I2C_STATUS_REGISTERS;
+    bool valid = true;
+    for (uint8_t i = 2; i < length; i += 2, reg++) {
+      if (reg < I2C_REGISTER_COUNT && (I2C_REGISTERS_WRITABLE & (1U << reg))) {
+        registerWrites[reg] = (data[i] << 8) | data[i + 1];
+        registersWritten |= 1U << reg;
+      } else {
+        valid = false;
       }
-      setAccessory(LOW);
+    }
+    return valid;
+  }
+  return false;
+}
 
-#ifdef USE_RT_EX_TURNTABLE
-    } else if ((activity >= 10) && (activity <= 17)) {
-      setExtra(activity);
+// Function to act on a framed command: <I2C_COMMAND_FRAMED, sequence, command..., CRC-8 of the preceding bytes>.
+static void receiveFramedCommand(const uint8_t *data, uint8_t length) {
+  if (crc8(data, length - 1) != data[length - 1]) {
+    commandsCorrupt++;
+    return;
+  }
+  uint8_t sequence = data[1];
+  if (sequenceReceived && sequence == lastSequence) {
+    // A retry of a command we've already acted on.
+    commandsDuplicate++;
+    return;
+  }
+  uint16_t dropped = commandsDropped;
+  if (!receiveCommand(data + 2, length - 3)) {
+    commandsInvalid++;
+    return;
+  }
+  // A dropped command hasn't been acted on, so a retry with the same sequence number must be accepted.
+  if (commandsDropped == dropped) {
+    lastSequence = sequence;
+    sequenceReceived = true;
+  }
+}
+
+// Function to queue a received I2C command for processCommandQueue(), this runs in the I2C interrupt so must be quick.
+void receiveEvent(int received) {
+  uint8_t data[I2C_RECEIVE_SIZE];
+  uint8_t length = 0;
+  // Read every byte, even if we have nothing to do, to avoid timeouts in the CS.
+  while (Wire.available()) {
+    uint8_t value = Wire.read();
+    if (length < I2C_RECEIVE_SIZE) {
+      data[length++] = value;
+    }
+  }
+  if (received > I2C_RECEIVE_SIZE) {
+    commandsInvalid++;
+  } else if (length > 3 && data[0] == I2C_COMMAND_FRAMED) {
+    receiveFramedCommand(data, length);
+  } else if (!receiveCommand(data, length)) {
+    commandsInvalid++;
+  }
+}
+
+// Function to apply the register writes received by receiveEvent().
+static void processRegisterWrites() {
+  static uint16_t targetHigh = 0;
+  uint16_t values[I2C_REGISTER_COUNT];
+#ifndef ESP32
+  noInterrupts();
+#endif
+  uint16_t written = registersWritten;
+  registersWritten = 0;
+  for (uint8_t reg = 0; reg < I2C_REGISTER_COUNT; reg++) {
+    values[reg] = registerWrites[reg];
+  }
+#ifndef ESP32
+  interrupts();
 #endif
+  if (!written) {
+    return;
+  }
+  LOG_DEBUG(REGISTERS_WRITTEN, written);
+  if (written & (1U << I2C_REGISTER_MAX_SPEED) && values[I2C_REGISTER_MAX_SPEED] > 0) {
+    stepper.setMaxSpeed(values[I2C_REGISTER_MAX_SPEED]);
+  }
+  if (written & (1U << I2C_REGISTER_ACCELERATION) && values[I2C_REGISTER_ACCELERATION] > 0) {
+    stepper.setAcceleration(values[I2C_REGISTER_ACCELERATION]);
+  }
+  if (written & (1U << I2C_REGISTER_PHASE)) {
+    if (values[I2C_REGISTER_PHASE] < 2 && !stepper.isRunning()) {
+      setPhase(values[I2C_REGISTER_PHASE]);
+    } else {
+      turntableError = TURNTABLE_ERROR_INVALID_COMMAND;
+    }
+  }
+  if (written & (1U << I2C_REGISTER_LED)) {
+    if (values[I2C_REGISTER_LED] >= 4 && values[I2C_REGISTER_LED] <= 7) {
+      setLEDActivity(values[I2C_REGISTER_LED]);
+    } else {
+      turntableError = TURNTABLE_ERROR_INVALID_COMMAND;
+    }
+  }
+  if (written & (1U << I2C_REGISTER_ACCESSORY)) {
+    setAccessory(values[I2C_REGISTER_ACCESSORY] ? HIGH : LOW);
+  }
+  // Move last, so a single write can set the phase or speed for the move.
+  if (written & (1U << I2C_REGISTER_TARGET)) {
+    targetHigh = values[I2C_REGISTER_TARGET];
+  }
+  if (written & (1U << (I2C_REGISTER_TARGET + 1))) {
+    processCommand((int32_t)((uint32_t)targetHigh << 16 | values[I2C_REGISTER_TARGET + 1]), currentPhase);
+  }
+}
 
-   } else {
-      if (debug) {
-        Serial.print(F("DEBUG: Invalid step count or activity provided, or turntable still moving: "));
-        Serial.print(steps);
-        Serial.print(F(" steps, activity: "));
-        Serial.println(activity);
+// Function to execute the commands queued by receiveEvent(), called from loop().
+void processCommandQueue() {
+  processRegisterWrites();
+  while (commandQueueTail != commandQueueHead) {
+    volatile I2CCommand &command = commandQueue[commandQueueTail & (I2C_COMMAND_QUEUE_SIZE - 1)];
+    long steps = command.steps;
+    uint8_t activity = command.activity;
+    uint8_t type = command.type;
+    // Free the entry before acting on it, as the command may take some time.
+    commandQueueTail = commandQueueTail + 1;
+    if (type == COMMAND_POSITION) {
+      processPositionCommand(steps);
+      continue;
+    }
+    if (type == COMMAND_GEARED_MOVE) {
+      // The original command only has 16 bits, so large step counts rely on the gearing factor.
+      if (gearingFactor > 10) {
+        gearingFactor = 10;
       }
+      LOG_DEBUG(GEARED_MOVE, gearingFactor, steps);
+      steps *= gearingFactor;
     }
+    processCommand(steps, activity);
+  }
+}
+
+// Function to move to a position from the stored position table.
+void processPositionCommand(uint8_t index) {
+  long steps;
+  uint8_t flags;
+  if (!getStoredPosition(index, steps, flags)) {
+    turntableError = TURNTABLE_ERROR_INVALID_COMMAND;
+    LOG_DEBUG(POSITION_UNSET, index);
+    return;
+  }
+  LOG_DEBUG(POSITION, index, steps, flags);
+  processCommand(steps, flags & POSITION_FLAG_PHASE, (flags & POSITION_FLAG_DIRECTION) >> 1);
+}
+
+// Function to define the action on a received command, steps are the full stepper step count.
+void processCommand(long steps, uint8_t activity, uint8_t direction) {
+  LOG_DEBUG(COMMAND, steps, activity);
+  if (steps >= 0 && steps <= fullTurnSteps && activity < 2 && !stepper.isRunning() && !calibrating && homed != 0) {
+    // Activities 0/1 require turning and setting phase, process only if stepper is not running or homing.
+    LOG_DEBUG(COMMAND_MOVE, steps, activity);
+    turntableError = TURNTABLE_ERROR_NONE;
+    moveToPosition(steps, activity, direction);
+  } else if (activity == 2 && !stepper.isRunning() && (!calibrating || homed == 2)) {
+    // Activity 2 needs to reset our homed flag to initiate the homing process, only if stepper not running.
+    LOG_DEBUG(COMMAND_HOME);
+    initiateHoming();
+  } else if (activity == 3 && !stepper.isRunning() && (!calibrating || homed == 2)) {
+    // Activity 3 will initiate calibration sequence, only if stepper not running.
+    LOG_DEBUG(COMMAND_CALIBRATE);
+    initiateCalibration();
+  } else if (activity > 3 && activity < 8) {
+    // Activities 4 through 7 set LED state.
+    LOG_DEBUG(COMMAND_LED, activity);
+    setLEDActivity(activity);
+  } else if (activity == 8) {
+    // Activity 8 turns accessory pin on at any time.
+    LOG_DEBUG(COMMAND_ACCESSORY_ON);
+    setAccessory(HIGH);
+  } else if (activity == 9) {
+    // Activity 9 turns accessory pin off at any time.
+    LOG_DEBUG(COMMAND_ACCESSORY_OFF);
+    setAccessory(LOW);
+
+#ifdef USE_RT_EX_TURNTABLE
+  } else if ((activity >= 10) && (activity <= 17)) {
+    setExtra(activity);
+#endif
+
   } else {
-  // Even if we have nothing to do, we need to read and discard all the bytes to avoid timeouts in the CS.
-    if (debug) {
-      Serial.println(F("DEBUG: Incorrect number of bytes received, discarding"));
-    }
-    while (Wire.available()) {
-      Wire.read();
+    turntableError = TURNTABLE_ERROR_INVALID_COMMAND;
+    LOG_DEBUG(COMMAND_INVALID, steps, activity);
+  }
+}
+
+// Function to check for received commands that haven't been executed yet.
+static bool commandPending() {
+  return commandQueueHead != commandQueueTail || (registersWritten & (1U << (I2C_REGISTER_TARGET + 1)));
+}
+
+// Function to update the extended status frame, called from loop().
+// Multi-byte values are sent MSB first, positions are in stepper steps:
+//  0     1 while moving, 0 once finished, as the basic reply (filled in by requestEvent())
+//  1     State, TURNTABLE_STATE_*
+//  2     Flags, STATUS_FLAG_*
+//  3     Last error, TURNTABLE_ERROR_*
+//  4     Change counter, incremented whenever the state, flags, error or target change
+//  5-8   Current position
+//  9-12  Target position
+//  13    I2C_PROTOCOL_VERSION, the extended commands supported
+// The read only registers are updated here too, along with the current values of the writable registers.
+void updateStatusFrame() {
+  static uint8_t lastState = TURNTABLE_STATE_IDLE;
+  static uint8_t lastFlags = 0;
+  static uint8_t lastError = TURNTABLE_ERROR_NONE;
+  static long lastStatusTarget = 0;
+  uint8_t state;
+  uint8_t flags = 0;
+  if (calibrating) {
+    state = TURNTABLE_STATE_CALIBRATING;
+  } else if (homed == 0) {
+    state = TURNTABLE_STATE_HOMING;
+  } else if (stepper.isRunning()) {
+    state = TURNTABLE_STATE_MOVING;
+  } else {
+    state = TURNTABLE_STATE_IDLE;
+  }
+  if (stepper.isRunning()) flags |= STATUS_FLAG_MOVING;
+  if (homed == 1) flags |= STATUS_FLAG_HOMED;
+  if (homed == 2) flags |= STATUS_FLAG_HOME_FAILED;
+  if (calibrating) flags |= STATUS_FLAG_CALIBRATING;
+  if (fullTurnSteps > 0) flags |= STATUS_FLAG_CALIBRATED;
+  if (currentPhase) flags |= STATUS_FLAG_PHASE_SWITCHED;
+  if (commandPending()) flags |= STATUS_FLAG_COMMAND_PENDING;
+  long position = getPosition();
+  long target = lastStep;
+#if defined(ATTENTION_PIN)
+  if (attention) flags |= STATUS_FLAG_ATTENTION;
+#endif
+  if (state != lastState || flags != lastFlags || turntableError != lastError || target != lastStatusTarget) {
+#if defined(ATTENTION_PIN)
+    // Moves, homing and calibration have all finished when we leave their state.
+    if (state != lastState && lastState != TURNTABLE_STATE_IDLE) {
+      setAttention(true);
+      flags |= STATUS_FLAG_ATTENTION;
     }
+#endif
+    statusChangeCount++;
+    lastState = state;
+    lastFlags = flags;
+    lastError = turntableError;
+    lastStatusTarget = target;
   }
+  // requestEvent() may interrupt, so only update the frame while it can't.
+#ifndef ESP32
+  noInterrupts();
+#endif
+  statusFrame[1] = state;
+  statusFrame[2] = flags;
+  statusFrame[3] = turntableError;
+  statusFrame[4] = statusChangeCount;
+  for (uint8_t i = 0; i < 4; i++) {
+    statusFrame[5 + i] = position >> (24 - i * 8);
+    statusFrame[9 + i] = target >> (24 - i * 8);
+  }
+  statusFrame[13] = I2C_PROTOCOL_VERSION;
+  registers[I2C_REGISTER_STATUS] = (state << 8) | flags;
+  registers[I2C_REGISTER_ERROR] = (turntableError << 8) | statusChangeCount;
+  registers[I2C_REGISTER_POSITION] = (uint32_t)position >> 16;
+  registers[I2C_REGISTER_POSITION + 1] = position;
+  registers[I2C_REGISTER_TARGET] = (uint32_t)target >> 16;
+  registers[I2C_REGISTER_TARGET + 1] = target;
+  registers[I2C_REGISTER_SPEED] = (int16_t)stepper.speed();
+  registers[I2C_REGISTER_MAX_SPEED] = stepper.maxSpeed();
+  registers[I2C_REGISTER_ACCELERATION] = stepper.acceleration();
+  registers[I2C_REGISTER_PHASE] = currentPhase;
+  registers[I2C_REGISTER_LED] = ledState;
+  registers[I2C_REGISTER_ACCESSORY] = accessoryState;
+  registers[I2C_REGISTER_FULL_TURN_STEPS] = (uint32_t)fullTurnSteps >> 16;
+  registers[I2C_REGISTER_FULL_TURN_STEPS + 1] = fullTurnSteps;
+  registers[I2C_REGISTER_VERSION] = I2C_PROTOCOL_VERSION;
+  registers[I2C_REGISTER_SEQUENCE] = lastSequence;
+#ifndef ESP32
+  interrupts();
+#endif
 }
 
 // Function to return the stepper status when requested by the IO_TurntableEX.h device driver.
 // 0 = Finished moving to the correct position.
-// 1 = Still moving.
+// 1 = Still moving, or a received command hasn't been executed yet.
+// After I2C_COMMAND_STATUS_MODE selects I2C_STATUS_EXTENDED, this is followed by the rest of the status frame.
+// After I2C_COMMAND_REGISTERS the registers are sent instead, from the selected register to the last.
 void requestEvent() {
   uint8_t stepperStatus;
-  if (stepper.isRunning()) {
+#if defined(ATTENTION_PIN)
+  if (attention) {
+    setAttention(false);
+  }
+#endif
+  if (i2cStatusMode == I2C_STATUS_REGISTERS) {
+    uint8_t data[I2C_REGISTER_COUNT * 2];
+    uint8_t length = 0;
+    for (uint8_t reg = registerPointer; reg < I2C_REGISTER_COUNT; reg++) {
+      data[length++] = registers[reg] >> 8;
+      data[length++] = registers[reg];
+    }
+    Wire.write(data, length);
+    return;
+  }
+  if (stepper.isRunning() || commandPending()) {
     stepperStatus = 1;
   } else  {
     stepperStatus = 0;
   }
-  Wire.write(stepperStatus);
+  if (i2cStatusMode == I2C_STATUS_EXTENDED) {
+    uint8_t frame[I2C_STATUS_FRAME_SIZE];
+    frame[0] = stepperStatus;
+    for (uint8_t i = 1; i < I2C_STATUS_FRAME_SIZE; i++) {
+      frame[i] = statusFrame[i];
+    }
+    Wire.write(frame, I2C_STATUS_FRAME_SIZE);
+  } else {
+    Wire.write(stepperStatus);
+  }
 }
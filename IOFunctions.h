@@ -25,27 +25,39 @@
 #include "defines.h"
 #include "TurntableFunctions.h"
 #include "EEPROMFunctions.h"
+#include "LogFunctions.h"
 #include "version.h"
 
-extern bool testCommandSent;    // Flag a test command has been sent via serial.
-extern uint8_t testActivity;    // Activity sent via serial.
-extern uint8_t testStepsMSB;
-extern uint8_t testStepsLSB;
 extern bool debug;
 extern bool sensorTesting;
 
 void setupWire();
+#if defined(ATTENTION_PIN)
+void setAttention(bool state);
+#endif
 void processSerialInput();
+void serialCommandB();
 void serialCommandC();
 void serialCommandD();
 void serialCommandE();
 void serialCommandH();
-void serialCommandM(long steps);
+void serialCommandL();
+void serialCommandM(long steps, long activity);
+void serialCommandN();
+void serialCommandP(uint8_t parameters, long *values);
+void serialCommandQ();
 void serialCommandR();
+void serialCommandS();
 void serialCommandT();
 void serialCommandV();
+void serialCommandW(uint8_t parameters, long *values);
 void displayTTEXConfig();
 void receiveEvent(int received);
+void processCommandQueue();
+void processPositionCommand(uint8_t index);
+void processCommand(long steps, uint8_t activity, uint8_t direction = ROTATE_DEFAULT);
+void updateStatusFrame();
 void requestEvent();
+uint8_t crc8(const uint8_t *data, uint8_t length);
 
 #endif
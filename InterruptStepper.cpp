@@ -0,0 +1,333 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "defines.h"
+
+#if defined(STEPPER_TIMER_INTERRUPT)
+
+#include "InterruptStepper.h"
+
+static InterruptStepper *timerStepper = nullptr;    // The stepper driven by the timer interrupt.
+static volatile bool timerRunning = false;          // Flag that the timer interrupt is scheduling steps.
+
+/*=============================================================
+ * Platform specific timer and critical section handling.
+=============================================================*/
+#if defined(ARDUINO_ARCH_AVR)
+
+#define TIMER_TICKS_PER_MICRO (F_CPU / 8000000UL)    // Timer1 runs with a prescaler of 8.
+#define TIMER_MIN_TICKS 64                          // Never schedule closer than 32us at 16MHz.
+static volatile unsigned long timerTicksRemaining = 0;  // Ticks still to count for intervals > 16 bits.
+
+static inline uint8_t enterCritical() {
+  uint8_t oldSREG = SREG;
+  cli();
+  return oldSREG;
+}
+
+static inline void exitCritical(uint8_t oldSREG) {
+  SREG = oldSREG;
+}
+
+// Load the compare register with the next period, long periods are counted in 16 bit chunks.
+static void setTimerPeriod(unsigned long ticks) {
+  if (ticks < TIMER_MIN_TICKS) {
+    ticks = TIMER_MIN_TICKS;
+  }
+  if (ticks > 65536UL) {
+    OCR1A = 65535;
+    timerTicksRemaining = ticks - 65536UL;
+  } else {
+    OCR1A = ticks - 1;
+    timerTicksRemaining = 0;
+  }
+}
+
+static void setupTimer() {
+  TCCR1A = 0;                                       // Normal port operation, no PWM on pins 9/10.
+  TCCR1B = _BV(WGM12) | _BV(CS11);                  // CTC mode on OCR1A, prescaler 8.
+  TIMSK1 &= ~_BV(OCIE1A);
+}
+
+static void startTimerInterrupt(unsigned long micros) {
+  TCNT1 = 0;
+  setTimerPeriod(micros * TIMER_TICKS_PER_MICRO);
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+}
+
+ISR(TIMER1_COMPA_vect) {
+  if (timerTicksRemaining) {
+    setTimerPeriod(timerTicksRemaining);
+    return;
+  }
+  unsigned long interval = timerStepper->timerStep();
+  if (interval) {
+    setTimerPeriod(interval * TIMER_TICKS_PER_MICRO);
+  } else {
+    TIMSK1 &= ~_BV(OCIE1A);
+    timerRunning = false;
+  }
+}
+
+#elif defined(ESP32)
+
+static hw_timer_t *stepTimer = nullptr;
+static portMUX_TYPE stepperMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint8_t enterCritical() {
+  if (xPortInIsrContext()) {
+    portENTER_CRITICAL_ISR(&stepperMux);
+  } else {
+    portENTER_CRITICAL(&stepperMux);
+  }
+  return 0;
+}
+
+static inline void exitCritical(uint8_t) {
+  if (xPortInIsrContext()) {
+    portEXIT_CRITICAL_ISR(&stepperMux);
+  } else {
+    portEXIT_CRITICAL(&stepperMux);
+  }
+}
+
+static void IRAM_ATTR onStepTimer() {
+  portENTER_CRITICAL_ISR(&stepperMux);
+  unsigned long interval = timerStepper->timerStep();
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  if (interval) {
+    timerAlarm(stepTimer, interval, true, 0);
+  } else {
+    timerStop(stepTimer);
+    timerRunning = false;
+  }
+#else
+  if (interval) {
+    timerAlarmWrite(stepTimer, interval, true);
+  } else {
+    timerAlarmDisable(stepTimer);
+    timerRunning = false;
+  }
+#endif
+  portEXIT_CRITICAL_ISR(&stepperMux);
+}
+
+static void setupTimer() {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  stepTimer = timerBegin(1000000);                  // 1MHz, 1us per tick.
+  timerStop(stepTimer);
+  timerAttachInterrupt(stepTimer, &onStepTimer);
+#else
+  stepTimer = timerBegin(0, 80, true);              // 80MHz APB / 80, 1us per tick.
+  timerAttachInterrupt(stepTimer, &onStepTimer, true);
+#endif
+}
+
+static void startTimerInterrupt(unsigned long micros) {
+  timerWrite(stepTimer, 0);
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  timerAlarm(stepTimer, micros, true, 0);
+  timerStart(stepTimer);
+#else
+  timerAlarmWrite(stepTimer, micros, true);
+  timerAlarmEnable(stepTimer);
+#endif
+}
+
+#else
+
+// No supported timer, InterruptStepper::run() falls back to polling.
+#define STEPPER_TIMER_POLLED
+
+static inline uint8_t enterCritical() {
+  noInterrupts();
+  return 0;
+}
+
+static inline void exitCritical(uint8_t) {
+  interrupts();
+}
+
+static void setupTimer() {}
+
+#endif
+
+/*=============================================================
+ * InterruptStepper
+=============================================================*/
+InterruptStepper::InterruptStepper(const AccelStepper &driver) : AccelStepper(driver) {}
+
+void InterruptStepper::begin() {
+  timerStepper = this;
+  setupTimer();
+  startTimer();
+}
+
+void InterruptStepper::moveTo(long absolute) {
+  uint8_t state = enterCritical();
+  AccelStepper::moveTo(absolute);
+  exitCritical(state);
+  startTimer();
+}
+
+void InterruptStepper::move(long relative) {
+  uint8_t state = enterCritical();
+  AccelStepper::move(relative);
+  exitCritical(state);
+  startTimer();
+}
+
+void InterruptStepper::stop() {
+  uint8_t state = enterCritical();
+  AccelStepper::stop();
+  exitCritical(state);
+  startTimer();
+}
+
+void InterruptStepper::setCurrentPosition(long position) {
+  uint8_t state = enterCritical();
+  AccelStepper::setCurrentPosition(position);
+  exitCritical(state);
+}
+
+void InterruptStepper::setMaxSpeed(float speed) {
+  if (speed < 0.0) {
+    speed = -speed;
+  }
+  if (speed != AccelStepper::maxSpeed()) {
+    setRamp(speed, acceleration());
+  }
+}
+
+void InterruptStepper::setAcceleration(float acceleration) {
+  if (acceleration < 0.0) {
+    acceleration = -acceleration;
+  }
+  if (acceleration != 0.0 && acceleration != AccelStepper::acceleration()) {
+    setRamp(AccelStepper::maxSpeed(), acceleration);
+  }
+}
+
+long InterruptStepper::currentPosition() {
+  uint8_t state = enterCritical();
+  long position = AccelStepper::currentPosition();
+  exitCritical(state);
+  return position;
+}
+
+long InterruptStepper::targetPosition() {
+  uint8_t state = enterCritical();
+  long position = AccelStepper::targetPosition();
+  exitCritical(state);
+  return position;
+}
+
+float InterruptStepper::speed() {
+  uint8_t state = enterCritical();
+  float speed = AccelStepper::speed();
+  exitCritical(state);
+  return speed;
+}
+
+float InterruptStepper::maxSpeed() {
+  uint8_t state = enterCritical();
+  float speed = AccelStepper::maxSpeed();
+  exitCritical(state);
+  return speed;
+}
+
+long InterruptStepper::distanceToGo() {
+  uint8_t state = enterCritical();
+  long distance = AccelStepper::distanceToGo();
+  exitCritical(state);
+  return distance;
+}
+
+bool InterruptStepper::isRunning() {
+  uint8_t state = enterCritical();
+  bool running = AccelStepper::isRunning();
+  exitCritical(state);
+  return running;
+}
+
+boolean InterruptStepper::run() {
+#if defined(STEPPER_TIMER_POLLED)
+  return AccelStepper::run();
+#else
+  startTimer();
+  return isRunning();
+#endif
+}
+
+void InterruptStepper::setRamp(float speed, float acceleration) {
+  // The square roots and the table are worked out with interrupts enabled, only putting them in place holds them
+  // off, so millis(), DCC edges and I2C aren't held up. Only this and the main loop change the ramp.
+  RampParameters params;
+#if STEPPER_RAMP_ENGINE == TABLE_RAMP
+  uint16_t table[STEPPER_RAMP_TABLE_SIZE];
+#else
+  uint16_t *table = nullptr;
+#endif
+  rampParameters(params, speed, acceleration, table);
+  uint8_t state = enterCritical();
+  applyRampParameters(params);
+  exitCritical(state);
+  startTimer();
+}
+
+unsigned long InterruptStepper::timerStep() {
+  // The previous non blocking step pulse must end first, check again shortly if it can't yet.
+  if (!finishStepPulse()) {
+    return 1;
+  }
+  if (!_stepInterval) {
+    return 0;
+  }
+  if (_direction == DIRECTION_CW) {
+    stepForward();
+  } else {
+    stepBackward();
+  }
+  // Only FIXED_RAMP and TABLE_RAMP are allowed with the timer (see defines.h), so there's no
+  // floating point maths here.
+  unsigned long interval = computeNewSpeed();
+  if (!finishStepPulse() && !interval) {
+    // Last step of the move, come back to end the pulse.
+    return 1;
+  }
+  return interval;
+}
+
+void InterruptStepper::startTimer() {
+#if !defined(STEPPER_TIMER_POLLED)
+  if (timerStepper == nullptr) {
+    return;
+  }
+  uint8_t state = enterCritical();
+  if (!timerRunning && _stepInterval) {
+    // The first step of a move is due straight away, as it is when polling.
+    timerRunning = true;
+    startTimerInterrupt(1);
+  }
+  exitCritical(state);
+#endif
+}
+
+#endif
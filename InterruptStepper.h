@@ -0,0 +1,74 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * This file contains the timer interrupt driven stepper used
+ * when STEPPER_TIMER_INTERRUPT is defined. Steps are emitted
+ * from a hardware timer (Timer1 on AVR, a hardware timer on
+ * ESP32) at the interval calculated by AccelStepper, so loop()
+ * is only required for housekeeping.
+=============================================================*/
+
+#ifndef INTERRUPTSTEPPER_H
+#define INTERRUPTSTEPPER_H
+
+#include <Arduino.h>
+#include "AccelStepper.h"
+
+class InterruptStepper : public AccelStepper {
+public:
+  // Construct from one of the standard stepper definitions, eg. InterruptStepper stepper = A4988;
+  InterruptStepper(const AccelStepper &driver);
+
+  // Configure the hardware timer, call once the speed and acceleration have been set.
+  void begin();
+
+  // Interrupt safe versions of the AccelStepper calls used by EX-Turntable.
+  // Those that change the target will start the timer if a step is now required.
+  void moveTo(long absolute);
+  void move(long relative);
+  void stop();
+  void setCurrentPosition(long position);
+  void setMaxSpeed(float speed);
+  void setAcceleration(float acceleration);
+  long currentPosition();
+  long targetPosition();
+  float speed();
+  float maxSpeed();
+  long distanceToGo();
+  bool isRunning();
+
+  // Housekeeping only when the timer is in use, returns true while still moving.
+  // On platforms without a supported timer this falls back to polling AccelStepper::run().
+  boolean run();
+
+  // Called from the timer interrupt to perform the step that is due.
+  // Returns the interval in microseconds until the next step, or 0 if stopped. With non blocking
+  // step pulses it may instead return a short interval to end a pulse that is still too short.
+  unsigned long timerStep();
+
+private:
+  // Start the timer if a step is due and it isn't already running.
+  void startTimer();
+
+  // Change the speed and acceleration, with interrupts held off only while the new ramp is put in place.
+  void setRamp(float speed, float acceleration);
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * This file lists every message logged with LOG_ERROR(),
+ * LOG_INFO() and LOG_DEBUG(), as LOG_EVENT(name, level, text).
+ * Any values logged are printed after the text separated by
+ * "|". With LOG_COMPACT only the event number and the values
+ * are sent, the number being the position in this list, and
+ * tools/decode_log.py reads this file to turn them back into
+ * text. Add new events at the end so the numbers of existing
+ * events don't change.
+ *
+ * There is no include guard, as the file is included with
+ * different definitions of LOG_EVENT.
+=============================================================*/
+
+LOG_EVENT(HOMED, INFO, "Turntable homed successfully")
+LOG_EVENT(HOMING_STARTED, INFO, "Homing started")
+LOG_EVENT(HOMING_FAILED, ERROR, "ERROR: Turntable failed to home, setting random home position")
+LOG_EVENT(STORED_TARGETS, DEBUG, "DEBUG: Stored values for lastStep|lastTarget: ")
+LOG_EVENT(HOMING_TARGETS, DEBUG, "DEBUG: Recorded|last actual target: ")
+LOG_EVENT(HOMING_TARGET, DEBUG, "DEBUG: lastTarget: ")
+LOG_EVENT(MOVE_RECEIVED, INFO, "Received notification to move to step postion ")
+LOG_EVENT(MOVE_STEPS, INFO, "Position steps|moving steps: ")
+LOG_EVENT(MOVE_FORWARD, DEBUG, "DEBUG: Force forward move only")
+LOG_EVENT(MOVE_REVERSE, DEBUG, "DEBUG: Force reverse move only")
+LOG_EVENT(PHASE_SET, INFO, "Setting phase switch flag to: ")
+LOG_EVENT(PHASE_ANGLE_INVALID, ERROR, "ERROR: The defined phase switch angle is invalid, setting to default 45 degrees")
+LOG_EVENT(CALIBRATION_HOMING, INFO, "CALIBRATION: Phase 1, homing...")
+LOG_EVENT(CALIBRATION_ALREADY_HOMED, INFO, "Turntable already homed")
+LOG_EVENT(CALIBRATION_COUNTING, INFO, "CALIBRATION: Phase 2, counting full turn steps...")
+LOG_EVENT(CALIBRATION_FINDING_LIMIT, INFO, "CALIBRATION: Phase 2, finding limit switch...")
+LOG_EVENT(CALIBRATION_COUNTING_LIMIT, INFO, "CALIBRATION: Phase 3, counting limit steps...")
+LOG_EVENT(CALIBRATION_COMPLETE, INFO, "CALIBRATION: Completed, storing full turn step count: ")
+LOG_EVENT(CALIBRATION_FAILED, ERROR, "CALIBRATION: FAILED, could not home, could not determine step count")
+LOG_EVENT(LIMIT_SENSOR_ALERT, ERROR, "ALERT! Limit sensor activitated, halting stepper")
+LOG_EVENT(HOME_SENSOR_ALERT, ERROR, "ALERT! Home sensor activitated, halting stepper")
+LOG_EVENT(DRIVER_INVERTED, DEBUG, "DEBUG: invertDirection|invertStep|invertEnable: ")
+LOG_EVENT(EEPROM_OUTDATED, INFO, "EEPROM version outdated, calibration required")
+LOG_EVENT(EEPROM_STEPS, DEBUG, "DEBUG: TTEX steps defined in EEPROM: ")
+LOG_EVENT(EEPROM_STEPS_INVALID, DEBUG, "DEBUG: TTEX steps defined in EEPROM are invalid: ")
+LOG_EVENT(EEPROM_STEPS_UNSET, DEBUG, "DEBUG: TTEX steps not defined in EEPROM")
+LOG_EVENT(REGISTERS_WRITTEN, DEBUG, "DEBUG: Registers written: ")
+LOG_EVENT(GEARED_MOVE, DEBUG, "DEBUG: gearingFactor|receivedSteps: ")
+LOG_EVENT(POSITION_UNSET, DEBUG, "DEBUG: Stored position not set: ")
+LOG_EVENT(POSITION, DEBUG, "DEBUG: Stored position|steps|flags: ")
+LOG_EVENT(COMMAND, DEBUG, "DEBUG: steps|activity: ")
+LOG_EVENT(COMMAND_MOVE, DEBUG, "DEBUG: Requested valid step move to|phase switch: ")
+LOG_EVENT(COMMAND_HOME, DEBUG, "DEBUG: Requested to home")
+LOG_EVENT(COMMAND_CALIBRATE, DEBUG, "DEBUG: Calibration requested")
+LOG_EVENT(COMMAND_LED, DEBUG, "DEBUG: Set LED state to: ")
+LOG_EVENT(COMMAND_ACCESSORY_ON, DEBUG, "DEBUG: Turn accessory pin on")
+LOG_EVENT(COMMAND_ACCESSORY_OFF, DEBUG, "DEBUG: Turn accessory pin off")
+LOG_EVENT(COMMAND_INVALID, DEBUG, "DEBUG: Invalid step count or activity provided, or turntable still moving, steps|activity: ")
+LOG_EVENT(DCC_ACCESSORY, DEBUG, "DEBUG: DCC accessory|thrown: ")
+LOG_EVENT(HOMING_TIME, INFO, "Homing time in ms: ")
+LOG_EVENT(HOMING_DRIFT, INFO, "Home sensor found relative to the last home position, steps: ")
+LOG_EVENT(POSITION_RECORD_INVALID, INFO, "No position saved while stopped, homing required")
+LOG_EVENT(POSITION_RECORD_STALE, INFO, "Home sensor doesn't match the saved position, homing required: ")
+LOG_EVENT(POSITION_RECORD_RESTORED, INFO, "Restored saved position, homing not required: ")
+LOG_EVENT(POSITION_RECORD_SAVED, DEBUG, "DEBUG: Saved position|lastStep|phase: ")
@@ -0,0 +1,189 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "LogFunctions.h"
+#include "TurntableFunctions.h"
+
+#define TELEMETRY_MIN_INTERVAL 20     // Shortest time between telemetry samples in ms, about 2.5KB/s of output.
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0 && LOG_BUFFER_SIZE <= 1024,
+              "LOG_BUFFER_SIZE must be a power of 2 no larger than 1024");
+
+// All three indexes run freely and wrap. Bytes from logTail to logHead are complete messages waiting to be
+// sent, and bytes from logHead to logNext are the message still being written.
+static char logBuffer[LOG_BUFFER_SIZE];
+static uint16_t logHead = 0;
+static uint16_t logNext = 0;
+static uint16_t logTail = 0;
+static bool logOverflow = false;      // The message being written didn't fit, so will be dropped.
+uint16_t logDropped = 0;              // Messages dropped as the buffer was full.
+
+LogBuffer Log;
+
+#if !defined(LOG_COMPACT)
+// The text of each event, left empty for events above LOG_LEVEL so the text isn't stored.
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_TEXT_ERROR(text) text
+#else
+#define LOG_TEXT_ERROR(text) ""
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_TEXT_INFO(text) text
+#else
+#define LOG_TEXT_INFO(text) ""
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_TEXT_DEBUG(text) text
+#else
+#define LOG_TEXT_DEBUG(text) ""
+#endif
+
+#define LOG_EVENT(name, level, text) static const char logText_##name[] PROGMEM = LOG_TEXT_##level(text);
+#include "LogEvents.h"
+#undef LOG_EVENT
+
+static const char *const logTexts[] PROGMEM = {
+#define LOG_EVENT(name, level, text) logText_##name,
+#include "LogEvents.h"
+#undef LOG_EVENT
+};
+#endif
+
+unsigned long telemetryInterval = 0;          // Time between telemetry samples in ms, 0 when off.
+static unsigned long lastTelemetry = 0;
+static unsigned long lastLoopMicros = 0;
+static unsigned long maxLoopMicros = 0;       // Longest pass through loop() since the last sample.
+static uint16_t telemetryLoops = 0;           // Passes through loop() since the last sample.
+
+size_t LogBuffer::write(uint8_t c) {
+  if (!logOverflow) {
+    if ((uint16_t)(logNext - logTail) >= LOG_BUFFER_SIZE) {
+      logOverflow = true;
+    } else {
+      logBuffer[logNext & (LOG_BUFFER_SIZE - 1)] = c;
+      logNext++;
+    }
+  }
+  if (c == '\n') {
+    if (logOverflow) {
+      logOverflow = false;
+      logNext = logHead;
+      logDropped++;
+    } else {
+      logHead = logNext;
+    }
+  }
+  return 1;
+}
+
+// Function to log an event, with LOG_COMPACT as #event value value..., otherwise as its text then value|value...
+void logEventValues(uint8_t event, const long *values, uint8_t count) {
+#if defined(LOG_COMPACT)
+  Log.print('#');
+  Log.print(event);
+  for (uint8_t i = 0; i < count; i++) {
+    Log.print(' ');
+    Log.print(values[i]);
+  }
+#else
+  Log.print((const __FlashStringHelper *)pgm_read_ptr(&logTexts[event]));
+  for (uint8_t i = 0; i < count; i++) {
+    if (i) Log.print('|');
+    Log.print(values[i]);
+  }
+#endif
+  Log.println();
+}
+
+// Function to send as much of the log as fits in the serial transmit buffer without waiting, called from loop().
+void processLog() {
+  int space = Serial.availableForWrite();
+  while (space > 0 && logTail != logHead) {
+    Serial.write(logBuffer[logTail & (LOG_BUFFER_SIZE - 1)]);
+    logTail++;
+    space--;
+  }
+}
+
+// Function to send the whole log, waiting for the serial port if needed. Used before printing directly to
+// Serial so the output stays in order.
+void flushLog() {
+  while (logTail != logHead) {
+    Serial.write(logBuffer[logTail & (LOG_BUFFER_SIZE - 1)]);
+    logTail++;
+  }
+}
+
+// Function to start telemetry samples every interval ms, or stop them if interval is 0.
+void setTelemetry(long interval) {
+  if (interval <= 0) {
+    telemetryInterval = 0;
+    return;
+  }
+  if (interval < TELEMETRY_MIN_INTERVAL) {
+    interval = TELEMETRY_MIN_INTERVAL;
+  }
+  telemetryInterval = interval;
+  lastTelemetry = millis();
+  lastLoopMicros = micros();
+  maxLoopMicros = 0;
+  telemetryLoops = 0;
+  Log.println(F("T,ms,position,target,speed,phase,home,limit,loops,maxLoopUs"));
+}
+
+// Function to time loop() and send a telemetry sample when one is due, called from loop().
+void processTelemetry() {
+  if (telemetryInterval == 0) return;
+  unsigned long now = micros();
+  unsigned long loopMicros = now - lastLoopMicros;
+  lastLoopMicros = now;
+  if (loopMicros > maxLoopMicros) maxLoopMicros = loopMicros;
+  if (telemetryLoops < 65535) telemetryLoops++;
+  unsigned long nowMillis = millis();
+  if (nowMillis - lastTelemetry < telemetryInterval) return;
+  // Keep to a fixed rate, but don't send a burst of samples to catch up after a stall.
+  lastTelemetry += telemetryInterval;
+  if (nowMillis - lastTelemetry >= telemetryInterval) {
+    lastTelemetry = nowMillis;
+  }
+  Log.print(F("T,"));
+  Log.print(nowMillis);
+  Log.print(F(","));
+  Log.print(stepper.currentPosition());
+  Log.print(F(","));
+  Log.print(stepper.targetPosition());
+  Log.print(F(","));
+  Log.print((long)stepper.speed());
+  Log.print(F(","));
+  Log.print(currentPhase);
+  Log.print(F(","));
+  Log.print(getHomeState() == HOME_SENSOR_ACTIVE_STATE);
+#if TURNTABLE_EX_MODE == TRAVERSER
+  Log.print(F(","));
+  Log.print(getLimitState() == LIMIT_SENSOR_ACTIVE_STATE);
+#else
+  Log.print(F(",0"));
+#endif
+  Log.print(F(","));
+  Log.print(telemetryLoops);
+  Log.print(F(","));
+  Log.println(maxLoopMicros);
+  telemetryLoops = 0;
+  maxLoopMicros = 0;
+}
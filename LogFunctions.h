@@ -0,0 +1,114 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * This file contains the buffered log used for output while
+ * the turntable is running. Log.print() only copies into a RAM
+ * buffer, and processLog() passes it on to Serial as space in
+ * the transmit buffer allows, so printing never waits for the
+ * serial port. A message that doesn't fit is dropped whole and
+ * counted rather than waiting.
+ *
+ * Messages are logged as events listed in LogEvents.h, using
+ * LOG_ERROR(), LOG_INFO() or LOG_DEBUG() with the event name
+ * and any values, eg. LOG_INFO(PHASE_SET, phase). Events above
+ * LOG_LEVEL are left out of the build along with their text,
+ * and debug events are only sent while <D> has debug on.
+ *
+ * It also contains the telemetry stream started with <W>.
+=============================================================*/
+
+#ifndef LOGFUNCTIONS_H
+#define LOGFUNCTIONS_H
+
+#include <Arduino.h>
+#include "defines.h"
+
+// Messages end at the '\n' written by println(), and are only sent once complete. Only use from the
+// main loop, not from interrupts.
+class LogBuffer : public Print {
+public:
+  size_t write(uint8_t c);
+  using Print::write;
+};
+
+// Every event in LogEvents.h, numbered in order.
+enum LogEvent : uint8_t {
+#define LOG_EVENT(name, level, text) LOG_EVENT_##name,
+#include "LogEvents.h"
+#undef LOG_EVENT
+  LOG_EVENT_COUNT
+};
+
+// The level of each event, so the LOG_ macros can check they're given the right events.
+enum LogEventLevel : uint8_t {
+#define LOG_EVENT(name, level, text) LOG_LEVEL_OF_##name = LOG_LEVEL_##level,
+#include "LogEvents.h"
+#undef LOG_EVENT
+};
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(event, ...) do { \
+    static_assert(LOG_LEVEL_OF_##event == LOG_LEVEL_ERROR, #event " is not an ERROR event"); \
+    logEvent(LOG_EVENT_##event, ##__VA_ARGS__); \
+  } while (0)
+#else
+#define LOG_ERROR(event, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(event, ...) do { \
+    static_assert(LOG_LEVEL_OF_##event == LOG_LEVEL_INFO, #event " is not an INFO event"); \
+    logEvent(LOG_EVENT_##event, ##__VA_ARGS__); \
+  } while (0)
+#else
+#define LOG_INFO(event, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(event, ...) do { \
+    static_assert(LOG_LEVEL_OF_##event == LOG_LEVEL_DEBUG, #event " is not a DEBUG event"); \
+    if (debug) logEvent(LOG_EVENT_##event, ##__VA_ARGS__); \
+  } while (0)
+#else
+#define LOG_DEBUG(event, ...) do {} while (0)
+#endif
+
+extern LogBuffer Log;
+extern uint16_t logDropped;
+extern unsigned long telemetryInterval;
+extern bool debug;
+
+void logEventValues(uint8_t event, const long *values, uint8_t count);
+
+inline void logEvent(uint8_t event) {
+  logEventValues(event, nullptr, 0);
+}
+
+template <typename... Values> void logEvent(uint8_t event, Values... values) {
+  const long list[] = {(long)values...};
+  logEventValues(event, list, sizeof...(values));
+}
+
+void processLog();
+void flushLog();
+void setTelemetry(long interval);
+void processTelemetry();
+
+#endif
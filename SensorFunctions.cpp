@@ -0,0 +1,333 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "SensorFunctions.h"
+#include "TurntableFunctions.h"
+#if defined(ESP32)
+#include "soc/gpio_reg.h"
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+static_assert(SENSOR_FILTER_SAMPLES >= 1 && SENSOR_FILTER_SAMPLES <= 255, "SENSOR_FILTER_SAMPLES must be from 1 to 255");
+
+const uint8_t homeSensorPin = HOME_SENSOR_PIN;      // Define pin for the home sensor.
+const uint8_t limitSensorPin = LIMIT_SENSOR_PIN;    // Define pin for the traverser mode limit sensor.
+
+// Platforms where the sensor pins can be read directly from the port registers.
+#if defined(ARDUINO_ARCH_AVR)
+#define SENSOR_FAST_INPUTS
+typedef uint8_t SensorPort;
+#elif defined(ESP32)
+#define SENSOR_FAST_INPUTS
+typedef uint32_t SensorPort;
+#endif
+
+#if defined(SENSOR_FAST_INPUTS)
+// The input register and bit of a sensor pin.
+struct SensorInput {
+  const volatile SensorPort *reg;
+  SensorPort mask;
+};
+static SensorInput homeInput;
+#if TURNTABLE_EX_MODE == TRAVERSER
+static SensorInput limitInput;
+#endif
+#endif
+
+static unsigned long lastSample = 0;                // Time of the last sample in us.
+static uint8_t homeCount;                           // Filter counters, 0 when LOW and SENSOR_FILTER_SAMPLES when HIGH.
+static uint8_t limitCount;
+static uint8_t sensorStates = 0;                    // Filtered pin level of each sensor, as SENSOR_ bits.
+static uint8_t sensorChanges = 0;                   // Sensors whose filtered state changed since getSensorChanges().
+
+// The stepper position at a sensor edge, recorded by interrupt so it's exact however long loop() takes to notice.
+// Only the first edge after the sensor has been still for DEBOUNCE_DELAY is recorded, so switch bounce is ignored.
+struct SensorLatch {
+  volatile long position;           // Stepper position at the edge.
+  volatile unsigned long edgeMillis;  // Time of the last edge, including bounces.
+  volatile bool state;              // Sensor state after the recorded edge.
+  volatile bool lastState;          // Sensor state after the last edge, to ignore other pins sharing a pin change interrupt.
+  volatile bool valid;              // An edge has been recorded and not yet used.
+};
+static SensorLatch homeLatch;
+#if TURNTABLE_EX_MODE == TRAVERSER
+static SensorLatch limitLatch;
+#endif
+
+#if defined(SENSOR_FAST_INPUTS)
+static SensorInput getSensorInput(uint8_t pin) {
+  SensorInput input;
+#if defined(ARDUINO_ARCH_AVR)
+  input.reg = portInputRegister(digitalPinToPort(pin));
+  input.mask = digitalPinToBitMask(pin);
+#else
+  // GPIO32 and above are in a second register.
+  if (pin < 32) {
+    input.reg = (const volatile SensorPort *)GPIO_IN_REG;
+    input.mask = 1UL << pin;
+  } else {
+    input.reg = (const volatile SensorPort *)GPIO_IN1_REG;
+    input.mask = 1UL << (pin - 32);
+  }
+#endif
+  return input;
+}
+#endif
+
+// Function to read the current level of every sensor pin, as SENSOR_ bits. Sensors on the same port share one read.
+static uint8_t readSensors() {
+  uint8_t levels = 0;
+#if defined(SENSOR_FAST_INPUTS)
+  SensorPort homePort = *homeInput.reg;
+  if (homePort & homeInput.mask) levels |= SENSOR_HOME;
+#if TURNTABLE_EX_MODE == TRAVERSER
+  SensorPort limitPort = (limitInput.reg == homeInput.reg) ? homePort : *limitInput.reg;
+  if (limitPort & limitInput.mask) levels |= SENSOR_LIMIT;
+#endif
+#else
+  if (digitalRead(homeSensorPin)) levels |= SENSOR_HOME;
+#if TURNTABLE_EX_MODE == TRAVERSER
+  if (digitalRead(limitSensorPin)) levels |= SENSOR_LIMIT;
+#endif
+#endif
+  return levels;
+}
+
+// Function to move a sensor's filter counter one step towards its latest sample, and change its state at either end.
+static void filterSensor(uint8_t &count, uint8_t sensor, uint8_t levels) {
+  if (levels & sensor) {
+    if (count < SENSOR_FILTER_SAMPLES) count++;
+    if (count == SENSOR_FILTER_SAMPLES && !(sensorStates & sensor)) {
+      sensorStates |= sensor;
+      sensorChanges |= sensor;
+    }
+  } else {
+    if (count > 0) count--;
+    if (count == 0 && (sensorStates & sensor)) {
+      sensorStates &= ~sensor;
+      sensorChanges |= sensor;
+    }
+  }
+}
+
+// Function to filter a sample of every sensor.
+static void filterSensors(uint8_t levels) {
+  filterSensor(homeCount, SENSOR_HOME, levels);
+#if TURNTABLE_EX_MODE == TRAVERSER
+  filterSensor(limitCount, SENSOR_LIMIT, levels);
+#endif
+}
+
+#if !defined(DISABLE_SENSOR_INTERRUPTS)
+// Function to record the stepper position if a sensor has changed state, called from the sensor interrupts.
+static void IRAM_ATTR latchSensor(SensorLatch &latch, uint8_t pin) {
+  bool state = digitalRead(pin);
+  if (state == latch.lastState) {
+    return;
+  }
+  latch.lastState = state;
+#if DEBOUNCE_DELAY > 0
+  unsigned long now = millis();
+  bool settled = now - latch.edgeMillis >= DEBOUNCE_DELAY;
+  latch.edgeMillis = now;
+  if (!settled) {
+    return;
+  }
+#endif
+  latch.position = stepper.currentPosition();
+  latch.state = state;
+  latch.valid = true;
+}
+
+#if defined(__AVR__)
+// Nano/Uno only have external interrupts on D2 and D3, so use the pin change interrupts which cover every pin.
+static void sensorPinChange() {
+  latchSensor(homeLatch, homeSensorPin);
+#if TURNTABLE_EX_MODE == TRAVERSER
+  latchSensor(limitLatch, limitSensorPin);
+#endif
+}
+
+ISR(PCINT0_vect) {
+  sensorPinChange();
+}
+#if defined(PCINT1_vect)
+ISR(PCINT1_vect) {
+  sensorPinChange();
+}
+#endif
+#if defined(PCINT2_vect)
+ISR(PCINT2_vect) {
+  sensorPinChange();
+}
+#endif
+#if defined(PCINT3_vect)
+ISR(PCINT3_vect) {
+  sensorPinChange();
+}
+#endif
+
+static bool attachSensor(SensorLatch &latch, uint8_t pin) {
+  if (!digitalPinToPCICR(pin)) {
+    return false;
+  }
+  latch.lastState = digitalRead(pin);
+  *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+  *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+  return true;
+}
+#else
+static void IRAM_ATTR homeSensorEdge() {
+  latchSensor(homeLatch, homeSensorPin);
+}
+
+#if TURNTABLE_EX_MODE == TRAVERSER
+static void IRAM_ATTR limitSensorEdge() {
+  latchSensor(limitLatch, limitSensorPin);
+}
+#endif
+
+static bool attachSensor(SensorLatch &latch, uint8_t pin) {
+  int interrupt = digitalPinToInterrupt(pin);
+  if (interrupt < 0) {
+    return false;
+  }
+  latch.lastState = digitalRead(pin);
+#if TURNTABLE_EX_MODE == TRAVERSER
+  attachInterrupt(interrupt, &latch == &homeLatch ? homeSensorEdge : limitSensorEdge, CHANGE);
+#else
+  attachInterrupt(interrupt, homeSensorEdge, CHANGE);
+#endif
+  return true;
+}
+#endif
+#endif
+
+// Function to configure the sensor pins, start the filters from their current state, and attach the interrupts
+// that record the stepper position at sensor edges, where the pins support it.
+void setupSensors() {
+#if HOME_SENSOR_ACTIVE_STATE == LOW
+  pinMode(homeSensorPin, INPUT_PULLUP);
+#elif HOME_SENSOR_ACTIVE_STATE == HIGH
+  pinMode(homeSensorPin, INPUT);
+#endif
+#if TURNTABLE_EX_MODE == TRAVERSER
+// Configure limit sensor pin in traverser mode
+#if LIMIT_SENSOR_ACTIVE_STATE == LOW
+  pinMode(limitSensorPin, INPUT_PULLUP);
+#elif LIMIT_SENSOR_ACTIVE_STATE == HIGH
+  pinMode(limitSensorPin, INPUT);
+#endif
+#endif
+#if defined(SENSOR_FAST_INPUTS)
+  homeInput = getSensorInput(homeSensorPin);
+#if TURNTABLE_EX_MODE == TRAVERSER
+  limitInput = getSensorInput(limitSensorPin);
+#endif
+#endif
+  // Start from the first reading, then filter until settled so a glitch at startup isn't taken as the state.
+  sensorStates = readSensors();
+  homeCount = (sensorStates & SENSOR_HOME) ? SENSOR_FILTER_SAMPLES : 0;
+  limitCount = (sensorStates & SENSOR_LIMIT) ? SENSOR_FILTER_SAMPLES : 0;
+  for (uint16_t sample = 0; sample < 2 * SENSOR_FILTER_SAMPLES; sample++) {
+    delayMicroseconds(SENSOR_SAMPLE_INTERVAL);
+    filterSensors(readSensors());
+  }
+  sensorChanges = 0;
+  lastSample = micros();
+
+#if !defined(DISABLE_SENSOR_INTERRUPTS)
+  if (!attachSensor(homeLatch, homeSensorPin)) {
+    Serial.println(F("WARNING: HOME_SENSOR_PIN does not support interrupts, home position depends on loop timing"));
+  }
+#if TURNTABLE_EX_MODE == TRAVERSER
+  if (!attachSensor(limitLatch, limitSensorPin)) {
+    Serial.println(F("WARNING: LIMIT_SENSOR_PIN does not support interrupts, step count depends on loop timing"));
+  }
+#endif
+#endif
+}
+
+// Function to sample and filter the sensors when a sample is due, called at the start of loop().
+void processSensors() {
+  unsigned long now = micros();
+  if (now - lastSample < SENSOR_SAMPLE_INTERVAL) return;
+  // Keep to a fixed rate, but a slow pass through loop() only counts as one sample.
+  lastSample += SENSOR_SAMPLE_INTERVAL;
+  if (now - lastSample >= SENSOR_SAMPLE_INTERVAL) {
+    lastSample = now;
+  }
+  filterSensors(readSensors());
+}
+
+// Function to get the filtered pin level of the home sensor.
+bool getHomeState() {
+  return sensorStates & SENSOR_HOME;
+}
+
+// Function to get the filtered pin level of the limit sensor.
+bool getLimitState() {
+  return sensorStates & SENSOR_LIMIT;
+}
+
+// Function to get the sensors whose filtered state has changed since the last call, as SENSOR_ bits.
+uint8_t getSensorChanges() {
+  uint8_t changes = sensorChanges;
+  sensorChanges = 0;
+  return changes;
+}
+
+// Function to take the recorded position, if any, of the latest edge of a sensor to the given state.
+static bool getSensorEdge(SensorLatch &latch, bool state, long &position) {
+#ifndef ESP32
+  noInterrupts();
+#endif
+  bool valid = latch.valid && latch.state == state;
+  position = latch.position;
+  latch.valid = false;
+#ifndef ESP32
+  interrupts();
+#endif
+  return valid;
+}
+
+// Function to get the stepper position when the home sensor last changed to state, false if it wasn't recorded.
+bool getHomeEdge(bool state, long &position) {
+  return getSensorEdge(homeLatch, state, position);
+}
+
+#if TURNTABLE_EX_MODE == TRAVERSER
+// Function to get the stepper position when the limit sensor last changed to state, false if it wasn't recorded.
+bool getLimitEdge(bool state, long &position) {
+  return getSensorEdge(limitLatch, state, position);
+}
+#endif
+
+// Function to get how far the stepper has moved since the home sensor became active, for setting the home
+// position. This is 0 if the edge wasn't recorded or we were already sitting on the sensor.
+long getHomeOffset() {
+  long edge;
+  if (getHomeEdge(HOME_SENSOR_ACTIVE_STATE, edge) && stepper.isRunning()) {
+    return stepper.currentPosition() - edge;
+  }
+  return 0;
+}
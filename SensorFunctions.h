@@ -0,0 +1,58 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * This file contains the home and limit sensor inputs.
+ * processSensors() samples all the sensor pins together every
+ * SENSOR_SAMPLE_INTERVAL microseconds, reading the port
+ * registers directly on AVR and ESP32, and debounces each one
+ * with a saturating counter. The counter moves one step towards
+ * each sample, and the filtered state only changes when it
+ * reaches the end, so a sensor has to read SENSOR_FILTER_SAMPLES
+ * more samples in its new state than its old one to change, and
+ * short glitches and switch bounce are ignored.
+ *
+ * It also records the stepper position at each sensor edge by
+ * interrupt, so homing and calibration can use the exact step
+ * the sensor triggered at rather than the step the filter
+ * noticed it.
+=============================================================*/
+
+#ifndef SENSORFUNCTIONS_H
+#define SENSORFUNCTIONS_H
+
+#include <Arduino.h>
+#include "defines.h"
+
+// Bits of getSensorChanges() for each sensor.
+#define SENSOR_HOME 0x01
+#define SENSOR_LIMIT 0x02
+
+void setupSensors();
+void processSensors();
+bool getHomeState();
+bool getLimitState();
+uint8_t getSensorChanges();
+bool getHomeEdge(bool state, long &position);
+#if TURNTABLE_EX_MODE == TRAVERSER
+bool getLimitEdge(bool state, long &position);
+#endif
+long getHomeOffset();
+
+#endif
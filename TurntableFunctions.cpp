@@ -39,15 +39,11 @@
 const long sanitySteps = SANITY_STEPS;              // Define an arbitrary number of steps to prevent indefinite spinning if homing/calibrations fails.
 
 #ifndef USE_RT_EX_TURNTABLE
-const uint8_t limitSensorPin = LIMIT_SENSOR_PIN;                   // Define pin 2 for the traverser mode limit sensor.
-const uint8_t homeSensorPin = HOME_SENSOR_PIN;                    // Define pin 5 for the home sensor.
 const uint8_t relay1Pin = RELAY_1_PIN;                        // Control pin for relay 1.
 const uint8_t relay2Pin = RELAY_2_PIN;                        // Control pin for relay 2.
 const uint8_t ledPin = LED_PIN;                           // Pin for LED output.
 const uint8_t accPin = ACC_PIN;                           // Pin for accessory output.
 #else
-const uint8_t limitSensorPin = LIMIT_SENSOR_PIN;    // Define pin for the traverser mode limit sensor.
-const uint8_t homeSensorPin = HOME_SENSOR_PIN;      // Define pin for the home sensor.
 //const uint8_t relay1Pin = 3;                        // Control pin for relay 1.
 const uint8_t relay2Pin = RELAY_PIN;                // Control pin for DPDT relay
 const uint8_t ledPin = LED_PIN;                     // Pin for LED output.
@@ -60,23 +56,20 @@ const int16_t totalMinutes = 21600;                 // Total minutes in one rota
 
 long lastStep = 0;                                  // Holds the last step value we moved to (enables least distance moves).
 uint8_t homed = 0;                                  // Flag to indicate homing state: 0 = not homed, 1 = homed, 2 = failed.
+uint8_t currentPhase = 0;                           // The phase last set by setPhase().
+uint8_t turntableError = TURNTABLE_ERROR_NONE;      // The last error, cleared by the next accepted command.
 long fullTurnSteps;                                 // Assign our defined full turn steps from config.h.
 long halfTurnSteps;                                 // Defines a half turn to enable moving the least distance.
 long phaseSwitchStartSteps;                         // Defines the step count at which phase should automatically invert.
 long phaseSwitchStopSteps;                          // Defines the step count at which phase should automatically revert.
 long lastTarget = sanitySteps;                      // Holds the last step target (prevents continuous rotation if homing fails).
 uint8_t ledState = 7;                               // Flag for the LED state: 4 on, 5 slow, 6 fast, 7 off.
+bool accessoryState = LOW;                          // The state last set by setAccessory().
 bool ledOutput = LOW;                               // Boolean for the actual state of the output LED pin.
 unsigned long ledMillis = 0;                        // Required for non blocking LED blink rate timing.
 bool calibrating = false;                           // Flag to prevent other rotation activities during calibration.
 uint8_t calibrationPhase = 0;                       // Flag for calibration phase.
 unsigned long calMillis = 0;                        // Required for non blocking calibration pauses.
-bool homeSensorState;                               // Stores the current home sensor state.
-bool limitSensorState;                              // Stores the current limit sensor state.
-bool lastHomeSensorState;                           // Stores the last home sensor state.
-bool lastLimitSensorState;                          // Stores the last limit sensor state.
-unsigned long lastLimitDebounce = 0;                // Stores the last time the limit sensor switched for debouncing.
-unsigned long lastHomeDebounce = 0;                 // Stores the last time the home sensor switched for debouncing.
 #ifdef INVERT_DIRECTION
 bool invertDirection = true;
 #else
@@ -93,42 +86,115 @@ bool invertEnable = true;
 bool invertEnable = false;
 #endif
 
-AccelStepper stepper = STEPPER_DRIVER;
+TurntableStepper stepper = STEPPER_DRIVER;
+
+// Stages of moveHome().
+#define HOMING_IDLE 0                               // Not homing.
+#define HOMING_SEEK 1                               // Moving towards the sensor.
+#define HOMING_CLEAR 2                              // Started on the sensor, moving back off it.
+#define HOMING_BACKOFF 3                            // Moving back to before the sensor edge.
+#define HOMING_APPROACH 4                           // Moving slowly towards the sensor for the final edge.
+
+static uint8_t homingStage = HOMING_IDLE;
+static unsigned long homingStartMillis = 0;         // When the current homing started.
+static bool homePositionKnown = false;              // Homed successfully before, so the drift can be reported.
+#if defined(HOMING_APPROACH_SPEED)
+static float homingMaxSpeed;                        // The speed to put back after homing.
+#endif
+#if defined(PERSIST_POSITION)
+static bool positionSaved = false;                  // The newest position record in EEPROM is where we are now.
+static bool positionSettling = false;               // Stopped, waiting POSITION_SAVE_DELAY to save the position.
+static unsigned long positionStoppedMillis = 0;     // When the turntable stopped.
+static uint8_t savedPhase = 0;                      // The phase in the newest position record.
+#endif
+
+#if STEPPER_RAMP_ENGINE == TABLE_RAMP
+uint16_t rampTable[STEPPER_RAMP_TABLE_SIZE];      // Step intervals for the acceleration ramp.
+#endif
+
+#if defined(PERSIST_POSITION)
+// Function to start as homed at the position saved when the turntable last stopped. This isn't done if there's
+// no saved position, the turntable was moving when the power went, or the home sensor says it's been moved. A
+// position within homeSensitivity of home that isn't on the sensor also homes, as it can't be checked.
+static void restorePosition() {
+  long position;
+  long step;
+  uint8_t phase;
+  if (!getPositionRecord(position, step, phase)) {
+    LOG_INFO(POSITION_RECORD_INVALID);
+    return;
+  }
+  long fromHome = position;
+#if TURNTABLE_EX_MODE == TURNTABLE
+  if (fullTurnSteps > 0) {
+    fromHome %= fullTurnSteps;
+    if (fromHome > fullTurnSteps / 2) {
+      fromHome -= fullTurnSteps;
+    } else if (fromHome < -fullTurnSteps / 2) {
+      fromHome += fullTurnSteps;
+    }
+  }
+#endif
+  // The home sensor must be active if, and only if, the saved position is at home.
+  bool atHome = fromHome <= homeSensitivity && fromHome >= -homeSensitivity;
+  if (atHome != (getHomeState() == HOME_SENSOR_ACTIVE_STATE)) {
+    LOG_INFO(POSITION_RECORD_STALE, position);
+    return;
+  }
+  stepper.setCurrentPosition(position);
+  lastStep = step;
+  setPhase(phase);
+  homed = 1;
+  positionSaved = true;
+  savedPhase = phase;
+  LOG_INFO(POSITION_RECORD_RESTORED, step);
+}
+
+// Function to mark the saved position out of date. This must be done before setting a new target, as with
+// STEPPER_TIMER_INTERRUPT the stepper starts moving as soon as it's set.
+static void clearSavedPosition() {
+  if (positionSaved) {
+    markPositionMoving();
+    positionSaved = false;
+  }
+  positionSettling = false;
+}
+
+// Function to keep the saved position up to date, called from loop() before the stepper runs. The saved position
+// is marked out of date as soon as a move is set, and saved again once stopped for POSITION_SAVE_DELAY.
+void processPositionRecord() {
+  bool stopped = homed == 1 && !calibrating && stepper.distanceToGo() == 0 && !stepper.isRunning();
+  if (!stopped || (positionSaved && currentPhase != savedPhase)) {
+    clearSavedPosition();
+    if (!stopped) {
+      return;
+    }
+  }
+  if (positionSaved) {
+    return;
+  }
+  if (!positionSettling) {
+    positionSettling = true;
+    positionStoppedMillis = millis();
+  } else if (millis() - positionStoppedMillis >= POSITION_SAVE_DELAY) {
+    writePositionRecord(stepper.currentPosition(), lastStep, currentPhase);
+    positionSaved = true;
+    positionSettling = false;
+    savedPhase = currentPhase;
+    LOG_DEBUG(POSITION_RECORD_SAVED, stepper.currentPosition(), lastStep, currentPhase);
+  }
+}
+#endif
 
 // Function configure sensor pins
 void startupConfiguration() {
 #if SELECTED_DRIVER == A4988_DRIVER
-  if (debug) {
-    Serial.println(F("DEBUG: invertDirection|invertStep|invertEnable: "));
-    Serial.print(invertDirection);
-    Serial.print(F("|"));
-    Serial.print(invertStep);
-    Serial.print(F("|"));
-    Serial.println(invertEnable);
-  }
+  LOG_DEBUG(DRIVER_INVERTED, invertDirection, invertStep, invertEnable);
   stepper.setEnablePin(STEPPER_ENABLE_PIN);                               // RKS add define instead of A2
   stepper.setPinsInverted(invertDirection, invertStep, invertEnable);
 #endif
-#if HOME_SENSOR_ACTIVE_STATE == LOW
-  pinMode(homeSensorPin, INPUT_PULLUP);
-#elif HOME_SENSOR_ACTIVE_STATE == HIGH
-  pinMode(homeSensorPin, INPUT);
-#endif
-#if TURNTABLE_EX_MODE == TRAVERSER
-// Configure limit sensor pin in traverser mode
-#if LIMIT_SENSOR_ACTIVE_STATE == LOW
-  pinMode(limitSensorPin, INPUT_PULLUP);
-#elif LIMIT_SENSOR_ACTIVE_STATE == HIGH
-  pinMode(limitSensorPin, INPUT);
-#endif
-#endif
-// Get the current sensor state
-  lastHomeSensorState = digitalRead(homeSensorPin);
-  homeSensorState = getHomeState();
-#if TURNTABLE_EX_MODE == TRAVERSER
-  lastLimitSensorState = digitalRead(limitSensorPin);
-  limitSensorState = getLimitState();
-#endif
+// Configure the home and limit sensors
+  setupSensors();
 
 // Configure relay output pins
 #ifndef USE_RT_EX_TURNTABLE
@@ -165,101 +231,208 @@ void startupConfiguration() {
 // Calculate phase invert/revert steps
   processAutoPhaseSwitch();
 #endif
+
+#if defined(PERSIST_POSITION)
+// Start at the saved position if it's still good, so homing isn't needed
+  if (!calibrating) {
+    restorePosition();
+  }
+#endif
 }
 
 // Function to define the stepper parameters.
 void setupStepperDriver() {
+#if STEPPER_RAMP_ENGINE == FIXED_RAMP
+  stepper.setRampEngine(AccelStepper::RAMP_FIXED);
+#elif STEPPER_RAMP_ENGINE == TABLE_RAMP
+  stepper.setRampEngine(AccelStepper::RAMP_TABLE);
+  stepper.setRampTable(rampTable, STEPPER_RAMP_TABLE_SIZE);
+#elif STEPPER_RAMP_ENGINE == SCURVE_RAMP
+  stepper.setRampEngine(AccelStepper::RAMP_SCURVE);
+  stepper.setJerk(STEPPER_JERK);
+#endif
   stepper.setMaxSpeed(STEPPER_MAX_SPEED);
   stepper.setAcceleration(STEPPER_ACCELERATION);
+#if defined(STEPPER_NONBLOCKING_PULSE)
+  stepper.setNonBlockingPulse(true);
+#endif
+#if defined(STEPPER_MAX_CATCH_UP)
+  stepper.setMaxCatchUp(STEPPER_MAX_CATCH_UP);
+#endif
+#if defined(STEPPER_TIMER_INTERRUPT)
+  stepper.begin();
+#endif
+}
+
+// Function to finish homing, successful or not.
+static void endHoming() {
+#if defined(HOMING_APPROACH_SPEED)
+  if (homingStage != HOMING_IDLE) {
+    stepper.setMaxSpeed(homingMaxSpeed);
+  }
+#endif
+  homingStage = HOMING_IDLE;
+}
+
+// Function to give up homing when the sensor can't be found.
+static void failHoming() {
+  endHoming();
+  stepper.setCurrentPosition(0);
+  lastStep = 0;
+  homed = 2;
+  homePositionKnown = false;
+  turntableError = TURNTABLE_ERROR_HOMING_FAILED;
+  LOG_ERROR(HOMING_FAILED);
+}
+
+// Function to report how long homing took, and how far the home sensor was from where the last homing put it.
+static void reportHoming(long edge) {
+  LOG_INFO(HOMING_TIME, millis() - homingStartMillis);
+  if (!homePositionKnown) {
+    homePositionKnown = true;
+    return;
+  }
+#if TURNTABLE_EX_MODE == TURNTABLE
+  // The sensor is found once a turn, so take the nearest whole turn from where it was found.
+  if (fullTurnSteps > 0) {
+    edge %= fullTurnSteps;
+    if (edge > fullTurnSteps / 2) {
+      edge -= fullTurnSteps;
+    } else if (edge < -fullTurnSteps / 2) {
+      edge += fullTurnSteps;
+    }
+  }
+#endif
+  (void) edge;                                      // Only used for logging, which LOG_LEVEL may leave out.
+  LOG_INFO(HOMING_DRIFT, edge);
 }
 
 // Function to find the home position.
+// With HOMING_APPROACH_SPEED defined, the sensor is found at HOMING_SEEK_SPEED, then the stepper backs off to
+// HOMING_BACKOFF_STEPS before where it triggered and approaches again at HOMING_APPROACH_SPEED for the final edge.
 void moveHome() {
   setPhase(0);
-  if (getHomeState() == HOME_SENSOR_ACTIVE_STATE) {
+  bool onSensor = getHomeState() == HOME_SENSOR_ACTIVE_STATE;
+  if (homingStage == HOMING_IDLE) {
+    homingStartMillis = millis();
+    homingStage = HOMING_SEEK;
+#if defined(HOMING_APPROACH_SPEED)
+    homingMaxSpeed = stepper.maxSpeed();
+    if (onSensor) {
+      // Move off the sensor first, so it's always approached from the same side.
+      stepper.setMaxSpeed(HOMING_APPROACH_SPEED);
+      stepper.enableOutputs();
+      stepper.move(-sanitySteps);
+      homingStage = HOMING_CLEAR;
+      LOG_INFO(HOMING_STARTED);
+      return;
+    }
+    stepper.setMaxSpeed(HOMING_SEEK_SPEED);
+#endif
+  }
+#if defined(HOMING_APPROACH_SPEED)
+  if (homingStage == HOMING_SEEK && onSensor) {
+    // Found the sensor at speed, stop dead rather than slowing down past it, then go back to a little before
+    // where it triggered to approach it again slowly. Any steps lost stopping don't matter as the edge is found
+    // again on the approach.
+    long edge;
+    if (!getHomeEdge(HOME_SENSOR_ACTIVE_STATE, edge)) {
+      edge = stepper.currentPosition();
+    }
+    stepper.setCurrentPosition(stepper.currentPosition());
+    stepper.moveTo(edge - HOMING_BACKOFF_STEPS);
+    homingStage = HOMING_BACKOFF;
+    return;
+  } else if (homingStage == HOMING_CLEAR) {
+    if (!onSensor) {
+      stepper.moveTo(stepper.currentPosition() - HOMING_BACKOFF_STEPS);
+      homingStage = HOMING_BACKOFF;
+    } else if (!stepper.isRunning()) {
+      failHoming();
+    }
+    return;
+  } else if (homingStage == HOMING_BACKOFF) {
+    if (!stepper.isRunning()) {
+      stepper.setMaxSpeed(HOMING_APPROACH_SPEED);
+      stepper.move(sanitySteps);
+      lastTarget = stepper.targetPosition();
+      homingStage = HOMING_APPROACH;
+    }
+    return;
+  }
+#endif
+  if (onSensor) {
+    // Home is where the sensor triggered, we may have gone a little past it since.
+    long offset = getHomeOffset();
+    long edge = stepper.currentPosition() - offset;
     stepper.stop();
 #if defined(DISABLE_OUTPUTS_IDLE)
     stepper.disableOutputs();
 #endif
-    stepper.setCurrentPosition(0);
-    lastStep = 0;
+    stepper.setCurrentPosition(offset);
+#if TURNTABLE_EX_MODE == TRAVERSER
+    lastStep = -offset;
+#else
+    lastStep = offset;
+#endif
     homed = 1;
-    Serial.println(F("Turntable homed successfully"));
-    if (debug) {
-      Serial.print(F("DEBUG: Stored values for lastStep/lastTarget: "));
-      Serial.print(lastStep);
-      Serial.print(F("/"));
-      Serial.println(lastTarget);
-    }
+    endHoming();
+    LOG_INFO(HOMED);
+    reportHoming(edge);
+    LOG_DEBUG(STORED_TARGETS, lastStep, lastTarget);
   } else if(!stepper.isRunning()) {
-    if (debug) {
-      Serial.print(F("DEBUG: Recorded/last actual target: "));
-      Serial.print(lastTarget);
-      Serial.print(F("/"));
-      Serial.println(stepper.targetPosition());
-    }
+    LOG_DEBUG(HOMING_TARGETS, lastTarget, stepper.targetPosition());
     if (stepper.targetPosition() == lastTarget) {
-      stepper.setCurrentPosition(0);
-      lastStep = 0;
-      homed = 2;
-      Serial.println(F("ERROR: Turntable failed to home, setting random home position"));
+      failHoming();
     } else {
       stepper.enableOutputs();
       stepper.move(sanitySteps);
       lastTarget = stepper.targetPosition();
-      if (debug) {
-        Serial.print(F("DEBUG: lastTarget: "));
-        Serial.println(lastTarget);
-      }
-      Serial.println(F("Homing started"));
+      LOG_DEBUG(HOMING_TARGET, lastTarget);
+      LOG_INFO(HOMING_STARTED);
     }
   }
 }
 
-// Function to move to the indicated position.
-void moveToPosition(long steps, uint8_t phaseSwitch) {
+// Function to move to the indicated position, in the given direction or ROTATE_DEFAULT for the configured direction.
+void moveToPosition(long steps, uint8_t phaseSwitch, uint8_t direction) {
   if (steps != lastStep) {
-    Serial.print(F("Received notification to move to step postion "));
-    Serial.println(steps);
+    LOG_INFO(MOVE_RECEIVED, steps);
     long moveSteps;
-    Serial.print(F("Position steps: "));
-    Serial.print(steps);
-#if PHASE_SWITCHING == AUTO
-    Serial.print(F(", Auto phase switch"));
-#else
-    Serial.print(F(", Phase switch flag: "));
-    Serial.print(phaseSwitch);
-#endif
 #if TURNTABLE_EX_MODE == TRAVERSER
 // If we're in traverser mode, very simple logic, negative move to limit, positive move to home.
+    (void) direction;
     moveSteps = lastStep - steps;
 #else
 // In turntable mode we can force always moving forwards or reverse, or (default) shortest distance
+    if (direction == ROTATE_DEFAULT) {
 #if defined(ROTATE_FORWARD_ONLY)
-    if (debug) Serial.println(F("Force forward move only"));
-    moveSteps = steps - lastStep;
-    if (moveSteps < 0) {
-      moveSteps += fullTurnSteps;
-    }
+      direction = ROTATE_FORWARD;
 #elif defined(ROTATE_REVERSE_ONLY)
-    if (debug) Serial.println(F("Force reverse move only"));
-    moveSteps = steps - lastStep;
-    if (moveSteps > 0) {
-      moveSteps -= fullTurnSteps;
+      direction = ROTATE_REVERSE;
+#endif
     }
-#else
-    if ((steps - lastStep) > halfTurnSteps) {
+    if (direction == ROTATE_FORWARD) {
+      LOG_DEBUG(MOVE_FORWARD);
+      moveSteps = steps - lastStep;
+      if (moveSteps < 0) {
+        moveSteps += fullTurnSteps;
+      }
+    } else if (direction == ROTATE_REVERSE) {
+      LOG_DEBUG(MOVE_REVERSE);
+      moveSteps = steps - lastStep;
+      if (moveSteps > 0) {
+        moveSteps -= fullTurnSteps;
+      }
+    } else if ((steps - lastStep) > halfTurnSteps) {
       moveSteps = steps - fullTurnSteps - lastStep;
     } else if ((steps - lastStep) < -halfTurnSteps) {
       moveSteps = fullTurnSteps - lastStep + steps;
     } else {
       moveSteps = steps - lastStep;
     }
-#endif  // Turntable forward/reverse/shortest distance
 #endif  // Turntable/traverser
-    Serial.print(F(" - moving "));
-    Serial.print(moveSteps);
-    Serial.println(F(" steps"));
+    LOG_INFO(MOVE_STEPS, steps, moveSteps);
 #if PHASE_SWITCHING == AUTO
     if ((steps >= 0 && steps < phaseSwitchStartSteps) || (steps <= fullTurnSteps && steps >= phaseSwitchStopSteps)) {
       phaseSwitch = 0;
@@ -267,24 +440,22 @@ void moveToPosition(long steps, uint8_t phaseSwitch) {
       phaseSwitch = 1;
     }
 #endif
-    Serial.print(F("Setting phase switch flag to: "));
-    Serial.println(phaseSwitch);
+#if defined(PERSIST_POSITION)
+    clearSavedPosition();
+#endif
+    LOG_INFO(PHASE_SET, phaseSwitch);
     setPhase(phaseSwitch);
     lastStep = steps;
     stepper.enableOutputs();
     stepper.move(moveSteps);
     lastTarget = stepper.targetPosition();
-    if (debug) {
-      Serial.print(F("DEBUG: Stored values for lastStep/lastTarget: "));
-      Serial.print(lastStep);
-      Serial.print(F("/"));
-      Serial.println(lastTarget);
-    }
+    LOG_DEBUG(STORED_TARGETS, lastStep, lastTarget);
   }
 }
 
 // Function to set phase.
 void setPhase(uint8_t phase) {
+  currentPhase = phase;
 #if RELAY_ACTIVE_STATE == HIGH
 #ifndef USE_RT_EX_TURNTABLE
   digitalWrite(relay1Pin, phase);
@@ -340,7 +511,14 @@ void calibration() {
 #if defined(DISABLE_OUTPUTS_IDLE)
     stepper.disableOutputs();
 #endif
-    fullTurnSteps = stepper.currentPosition();
+    // Count the steps to the sensor edge rather than to where we noticed it.
+    long edge;
+#if TURNTABLE_EX_MODE == TRAVERSER
+    bool latched = getLimitEdge(!LIMIT_SENSOR_ACTIVE_STATE, edge);
+#else
+    bool latched = getHomeEdge(HOME_SENSOR_ACTIVE_STATE, edge);
+#endif
+    fullTurnSteps = latched ? edge : stepper.currentPosition();
     if (fullTurnSteps < 0) {
       fullTurnSteps = -fullTurnSteps;
     }
@@ -351,8 +529,7 @@ void calibration() {
     calibrating = false;
     calibrationPhase = 0;
     writeEEPROM(fullTurnSteps);
-    Serial.print(F("CALIBRATION: Completed, storing full turn step count: "));
-    Serial.println(fullTurnSteps);
+    LOG_INFO(CALIBRATION_COMPLETE, fullTurnSteps);
     stepper.setCurrentPosition(stepper.currentPosition());
     homed = 0;
     lastTarget = sanitySteps;
@@ -362,20 +539,21 @@ void calibration() {
     // In TRAVERSER mode, we want our full step count to stop short of the limit switch, so need phase 3 to move away.
     stepper.stop();
     stepper.setCurrentPosition(stepper.currentPosition());
-    Serial.println(F("CALIBRATION: Phase 3, counting limit steps..."));
+    LOG_INFO(CALIBRATION_COUNTING_LIMIT);
     stepper.moveTo(0);
     lastStep = 0;
     calibrationPhase = 3;
 #endif
 #if TURNTABLE_EX_MODE == TRAVERSER
   } else if (calibrationPhase == 1 && lastStep == sanitySteps && getHomeState() == HOME_SENSOR_ACTIVE_STATE) {
-    Serial.println(F("CALIBRATION: Phase 2, finding limit switch..."));
+    LOG_INFO(CALIBRATION_FINDING_LIMIT);
 #else
   } else if (calibrationPhase == 1 && lastStep == sanitySteps && getHomeState() == HOME_SENSOR_ACTIVE_STATE && stepper.currentPosition() > homeSensitivity) {
-    Serial.println(F("CALIBRATION: Phase 2, counting full turn steps..."));
+    LOG_INFO(CALIBRATION_COUNTING);
 #endif
+    long offset = getHomeOffset();
     stepper.stop();
-    stepper.setCurrentPosition(0);
+    stepper.setCurrentPosition(offset);
     calibrationPhase = 2;
     stepper.enableOutputs();
 #if TURNTABLE_EX_MODE == TRAVERSER
@@ -386,11 +564,11 @@ void calibration() {
     lastStep = sanitySteps;
 #endif
   } else if (calibrationPhase == 0 && !stepper.isRunning() && homed == 1) {
-    Serial.println(F("CALIBRATION: Phase 1, homing..."));
+    LOG_INFO(CALIBRATION_HOMING);
     calibrationPhase = 1;
 #if TURNTABLE_EX_MODE == TRAVERSER
     if (getHomeState() == HOME_SENSOR_ACTIVE_STATE) {
-      Serial.println(F("Turntable already homed"));
+      LOG_INFO(CALIBRATION_ALREADY_HOMED);
     } else {
       stepper.enableOutputs();
       stepper.moveTo(sanitySteps);
@@ -401,22 +579,41 @@ void calibration() {
 #endif
     lastStep = sanitySteps;
   } else if ((calibrationPhase == 2 || calibrationPhase == 1) && !stepper.isRunning() && stepper.currentPosition() == sanitySteps) {
-    Serial.println(F("CALIBRATION: FAILED, could not home, could not determine step count"));
+    LOG_ERROR(CALIBRATION_FAILED);
 #if defined(DISABLE_OUTPUTS_IDLE)
     stepper.disableOutputs();
 #endif
     calibrating = false;
     calibrationPhase = 0;
+    turntableError = TURNTABLE_ERROR_CALIBRATION_FAILED;
   }
 }
 
+// Function to get the current position in the same steps as moveToPosition().
+long getPosition() {
+#if TURNTABLE_EX_MODE == TRAVERSER
+  // Traverser moves towards the limit sensor are negative stepper moves.
+  return -stepper.currentPosition();
+#else
+  // Shortest distance moves can leave the stepper position outside a single turn.
+  long position = stepper.currentPosition();
+  if (fullTurnSteps > 0) {
+    while (position < 0) {
+      position += fullTurnSteps;
+    }
+    while (position >= fullTurnSteps) {
+      position -= fullTurnSteps;
+    }
+  }
+  return position;
+#endif
+}
+
 // If phase switching is set to auto, calculate the trigger point steps based on the angle.
 #if PHASE_SWITCHING == AUTO
 void processAutoPhaseSwitch() {
   if (PHASE_SWITCH_ANGLE + 180 >= 360) {
-    Serial.print(F("ERROR: The defined phase switch angle of "));
-    Serial.print(PHASE_SWITCH_ANGLE);
-    Serial.println(F(" degrees is invalid, setting to default 45 degrees"));
+    LOG_ERROR(PHASE_ANGLE_INVALID);
   }
 #if PHASE_SWITCH_ANGLE + 180 >= 360
 #undef PHASE_SWITCH_ANGLE
@@ -427,36 +624,26 @@ void processAutoPhaseSwitch() {
 }
 #endif
 
-// Function to debounce and get the state of the homing sensor
-bool getHomeState() {
-  bool newHomeSensorState = digitalRead(homeSensorPin);
-  if (newHomeSensorState != lastHomeSensorState && (millis() - lastHomeDebounce) > DEBOUNCE_DELAY) {
-    lastHomeDebounce = millis();
-    lastHomeSensorState = newHomeSensorState;
-  }
-  return lastHomeSensorState;
-}
-
-// Function to debounce and get the state of the limit sensor
-bool getLimitState() {
-  bool newLimitSensorState = digitalRead(limitSensorPin);
-  if (newLimitSensorState != lastLimitSensorState && (millis() - lastLimitDebounce) > DEBOUNCE_DELAY) {
-    lastLimitDebounce = millis();
-    lastLimitSensorState = newLimitSensorState;
-  }
-  return lastLimitSensorState;
-}
-
 // Function to reset home state, triggering homing to happen
 void initiateHoming() {
+  endHoming();
+#if defined(PERSIST_POSITION)
+  clearSavedPosition();
+#endif
   homed = 0;
+  turntableError = TURNTABLE_ERROR_NONE;
   lastTarget = sanitySteps;
 }
 
 // Function to trigger calibration to begin
 void initiateCalibration() {
+  endHoming();
+#if defined(PERSIST_POSITION)
+  clearSavedPosition();
+#endif
   calibrating = true;
   homed = 0;
+  turntableError = TURNTABLE_ERROR_NONE;
   lastTarget = sanitySteps;
   clearEEPROM();
 }
@@ -468,6 +655,7 @@ void setLEDActivity(uint8_t activity) {
 
 // Function to set the state of the accessory pin
 void setAccessory(bool state) {
+  accessoryState = state;
   digitalWrite(accPin, state);
 }
 
@@ -515,3 +703,64 @@ void setExtra(uint8_t activity) {
 }
 
 #endif
+
+// Stepper with no outputs, used to time the acceleration ramp calculations.
+static void benchmarkStep() {}
+
+class BenchmarkStepper : public AccelStepper {
+public:
+  BenchmarkStepper() : AccelStepper(benchmarkStep, benchmarkStep) {}
+
+  // Perform a full move as fast as possible, returns the number of steps taken.
+  long runMove(long steps) {
+    long count = 0;
+    moveTo(steps);
+    while (_stepInterval) {
+      if (_direction == DIRECTION_CW) {
+        stepForward();
+      } else {
+        stepBackward();
+      }
+      computeNewSpeed();
+      count++;
+    }
+    return count;
+  }
+};
+
+// Function to time a full move with each ramp engine using the configured speed and acceleration.
+void benchmarkRampEngines() {
+  // Always a table of its own, the stepper's table was built for its current speed and acceleration.
+  uint16_t table[STEPPER_RAMP_TABLE_SIZE];
+  // Accelerate to max speed, cruise for 100 steps, then decelerate.
+  float rampSteps = (float)STEPPER_MAX_SPEED * STEPPER_MAX_SPEED / (2.0 * STEPPER_ACCELERATION);
+  long steps = (rampSteps < 9950) ? (long)(rampSteps * 2) + 100 : 20000;
+  for (uint8_t engine = AccelStepper::RAMP_FLOAT; engine <= AccelStepper::RAMP_SCURVE; engine++) {
+    BenchmarkStepper benchmark;
+    benchmark.setRampEngine((AccelStepper::RampEngine)engine);
+    benchmark.setRampTable(table, STEPPER_RAMP_TABLE_SIZE);
+    benchmark.setJerk(STEPPER_JERK);
+    benchmark.setMaxSpeed(STEPPER_MAX_SPEED);
+    benchmark.setAcceleration(STEPPER_ACCELERATION);
+    unsigned long startTime = micros();
+    long count = benchmark.runMove(steps);
+    unsigned long elapsed = micros() - startTime;
+    if (engine == AccelStepper::RAMP_FLOAT) {
+      Serial.print(F("FLOAT_RAMP: "));
+    } else if (engine == AccelStepper::RAMP_FIXED) {
+      Serial.print(F("FIXED_RAMP: "));
+    } else if (engine == AccelStepper::RAMP_TABLE) {
+      Serial.print(F("TABLE_RAMP: "));
+    } else {
+      Serial.print(F("SCURVE_RAMP: "));
+    }
+    Serial.print(count);
+    Serial.print(F(" steps in "));
+    Serial.print(elapsed);
+    Serial.print(F("us, "));
+    Serial.print((float)elapsed / count, 2);
+    Serial.print(F("us/step, "));
+    Serial.print((float)elapsed * (F_CPU / 1000000UL) / count, 0);
+    Serial.println(F(" cycles/step"));
+  }
+}
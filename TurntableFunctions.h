@@ -30,28 +30,43 @@
 #include "defines.h"
 #include "AccelStepper.h"
 #include "standard_steppers.h"
+#include "SensorFunctions.h"
+#if defined(STEPPER_TIMER_INTERRUPT)
+#include "InterruptStepper.h"
+#endif
 
 extern const long sanitySteps;
 extern bool calibrating;
 extern uint8_t homed;
-extern AccelStepper stepper;
+extern uint8_t currentPhase;
+extern uint8_t turntableError;
+extern uint8_t ledState;
+extern bool accessoryState;
+extern long lastStep;
+// The stepper type for STEPPER_DRIVER, driven by the timer interrupt if enabled.
+#if defined(STEPPER_TIMER_INTERRUPT)
+typedef StepperType<decltype(STEPPER_DRIVER), InterruptStepper>::type TurntableStepper;
+#else
+typedef StepperType<decltype(STEPPER_DRIVER), AccelStepper>::type TurntableStepper;
+#endif
+extern TurntableStepper stepper;
 extern long fullTurnSteps;
 extern long phaseSwitchStartSteps;
 extern long phaseSwitchStopSteps;
 extern long lastTarget;
-extern bool homeSensorState;
-extern bool limitSensorState;
 
 void startupConfiguration();
 void setupStepperDriver();
 void moveHome();
-void moveToPosition(long steps, uint8_t phaseSwitch);
+void moveToPosition(long steps, uint8_t phaseSwitch, uint8_t direction = ROTATE_DEFAULT);
 void setPhase(uint8_t phase);
+long getPosition();
 void processLED();
 void calibration();
 void processAutoPhaseSwitch();
-bool getHomeState();
-bool getLimitState();
+#if defined(PERSIST_POSITION)
+void processPositionRecord();
+#endif
 void initiateHoming();
 void initiateCalibration();
 void setLEDActivity(uint8_t activity);
@@ -61,4 +76,6 @@ void setAccessory(bool state);
 void setExtra(uint8_t activity);
 #endif
 
+void benchmarkRampEngines();
+
 #endif
@@ -124,7 +124,8 @@
 // 
 // If using a gearing or microstep setup with larger than 32767 steps, you need to set the
 // gearing factor appropriately.
-// Step counts sent from EX-CommandStation will be multiplied by this number.
+// Step counts sent from EX-CommandStation will be multiplied by this number. This isn't needed
+// by device drivers using the 32 bit move command, which send the full step count.
 #define STEPPER_GEARING_FACTOR 1
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -169,7 +170,111 @@
 // #define FULL_STEP_COUNT 4096
 // 
 //  Override the default debounce delay (in ms) if using mechanical home/limit switches that have
-//  "noisy" switch bounce issues.
+//  "noisy" switch bounce issues. A sensor must read its new state for about this long to change.
 //  In TRAVERSER mode, default is 10ms as these would typically use mechanical switches.
-//  In TURNTABLE mode, default is 0ms as these would typically use hall effect sensors.
+//  In TURNTABLE mode, default is 0ms as these would typically use hall effect sensors, which still
+//  ignores glitches of a single sample.
 // #define DEBOUNCE_DELAY 10
+// 
+//  The sensors are sampled every SENSOR_SAMPLE_INTERVAL (in us), and must read SENSOR_FILTER_SAMPLES
+//  more samples in their new state than their old one to change. The default number of samples
+//  covers DEBOUNCE_DELAY, with a minimum of 2.
+// #define SENSOR_SAMPLE_INTERVAL 500
+// #define SENSOR_FILTER_SAMPLES 20
+// 
+//  The home and limit sensors use interrupts to record the exact step they trigger at, which homing and
+//  calibration use. On Nano/Uno these are pin change interrupts, uncomment this if another library needs
+//  those interrupts, and the sensors will only be checked each time through the main loop.
+// #define DISABLE_SENSOR_INTERRUPTS
+// 
+//  Home in two stages by defining HOMING_APPROACH_SPEED: the home sensor is found quickly at
+//  HOMING_SEEK_SPEED (default STEPPER_MAX_SPEED), then the stepper backs off to HOMING_BACKOFF_STEPS
+//  before where it triggered and approaches again at HOMING_APPROACH_SPEED for the final position.
+//  This allows a higher STEPPER_MAX_SPEED without homing overshooting the sensor, and makes the home
+//  position more repeatable. HOMING_BACKOFF_STEPS should be more than the steps taken to accelerate
+//  to HOMING_APPROACH_SPEED. The stepper stops as soon as the sensor is found at HOMING_SEEK_SPEED
+//  without slowing down, so keep it to a speed the stepper can stop from. The time taken and how far
+//  home was from where the last homing put it are reported after each homing.
+//  In TRAVERSER mode, make sure there's room for this past the home sensor before the end of travel.
+// #define HOMING_APPROACH_SPEED 50
+// #define HOMING_SEEK_SPEED 800
+// #define HOMING_BACKOFF_STEPS 50
+// 
+//  Define PERSIST_POSITION to save the position in EEPROM once the traverser has been stopped for
+//  POSITION_SAVE_DELAY ms, so it starts up at that position without homing. Homing is still done if a
+//  move was under way when the power went off, the saved position can't be read, or the home sensor
+//  doesn't agree with the saved position, being active away from home or inactive at home. The position is saved to each of
+//  POSITION_RECORD_SLOTS slots in turn to spread the EEPROM wear. Only use this if the traverser can't
+//  be turned by hand while the power is off, as that can't be detected.
+// #define PERSIST_POSITION
+// #define POSITION_SAVE_DELAY 2000
+// #define POSITION_RECORD_SLOTS 8
+// 
+//  Define the engine used to calculate the stepper acceleration and deceleration ramp.
+//  FLOAT_RAMP : The original AccelStepper floating point calculations (default).
+//  FIXED_RAMP : Fixed point integer calculations, much faster on Nano/Uno which allows higher
+//               step rates with less jitter. Step timing is within 0.2% of FLOAT_RAMP.
+//  TABLE_RAMP : As FIXED_RAMP, but the ramp is calculated once into a table of step intervals at
+//               startup, so each step is a table lookup. Step timing is within 1% of FIXED_RAMP.
+//  SCURVE_RAMP : Jerk limited S-curve, acceleration builds up and dies away gradually rather than
+//               switching on and off, which is gentler on the mechanism. This allows a higher
+//               STEPPER_ACCELERATION to be used, reducing the overall move time.
+//  Use the <B> serial command to compare the time each engine takes per step.
+// #define STEPPER_RAMP_ENGINE FIXED_RAMP
+// 
+//  Override the number of entries in the TABLE_RAMP table, each uses 2 bytes of RAM. When the
+//  ramp has more steps than this, intervals between entries are interpolated.
+// #define STEPPER_RAMP_TABLE_SIZE 64
+// 
+//  Override the jerk (rate of change of acceleration in steps/s/s/s) used by SCURVE_RAMP. Lower
+//  values give a softer start and stop, the default is four times STEPPER_ACCELERATION.
+// #define STEPPER_JERK 100
+// 
+//  Generate steps from a hardware timer interrupt (Timer1 on Nano/Uno, a hardware timer on ESP32)
+//  instead of polling in the main loop, so serial output and I2C activity can't stretch the step
+//  timing. The ramp is calculated in the interrupt, so only FIXED_RAMP (the default with this) or
+//  TABLE_RAMP above may be used. Note Timer1 PWM on pins 9 and 10 is unavailable.
+// #define STEPPER_TIMER_INTERRUPT
+// 
+//  For step/direction drivers (A4988, TMC2209 etc.), raise the step pin and lower it again on a later
+//  pass rather than waiting in a delay for every step. Useful at high microstep counts.
+// #define STEPPER_NONBLOCKING_PULSE
+// 
+//  Time each step from when the previous step was due rather than when it actually happened, so
+//  a late pass through the main loop doesn't slow down the rest of the move. Late steps are caught
+//  up by at most this many microseconds. Use the <L> serial command to see how late steps have been.
+// #define STEPPER_MAX_CATCH_UP 500
+// 
+//  Pull this pin low to tell EX-CommandStation that a move has completed, homing has failed, or
+//  calibration has ended, rather than it needing to keep asking. It's released when the status is
+//  next read via I2C. The pin is open drain, so several devices can share one line and pull-up.
+// #define ATTENTION_PIN 8
+// 
+//  Leave messages out of the build to save flash. LOG_LEVEL_DEBUG includes everything (debug messages
+//  still need turning on with <D>), LOG_LEVEL_INFO leaves out debug messages, LOG_LEVEL_ERROR only
+//  keeps errors, and LOG_LEVEL_NONE leaves out all messages.
+// #define LOG_LEVEL LOG_LEVEL_INFO
+// 
+//  Send messages as numbered events rather than text, saving the flash used by their text. Pass the
+//  serial output through tools/decode_log.py to turn them back into text.
+// #define LOG_COMPACT
+// 
+//  Bytes of RAM used to hold output until the serial port can send it, so printing never holds up the
+//  stepper. If it fills, whole messages are dropped and counted by <Q>. Must be a power of 2.
+// #define LOG_BUFFER_SIZE 256
+// 
+//  Default time in ms between telemetry samples sent when <W> turns them on.
+// #define TELEMETRY_INTERVAL 100
+// 
+//  Number of positions that can be stored in EEPROM with the <P> serial command, each using 5 bytes.
+//  EX-CommandStation can then move to a stored position by its index.
+// #define POSITION_TABLE_SIZE 16
+// 
+//  Enable the DCC accessory decoder with the DCC signal on pin D2, via a suitable opto-isolator.
+//  Accessory addresses from DCC_ACCESSORY_ADDRESS move to the positions stored with <P>, closed or
+//  thrown, using the phase stored with the position. The next 4 addresses home, calibrate, and turn
+//  the LED and accessory output on (thrown) or off (closed). With STEPPER_TIMER_INTERRUPT, packets
+//  can be missed while the traverser is moving, as the step interrupt delays timing the DCC signal.
+//  In TRAVERSER mode D2 is the limit sensor, so define DCC_INPUT_PIN as another pin that supports
+//  interrupts.
+// #define DCC_ACCESSORY_ADDRESS 101
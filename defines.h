@@ -29,6 +29,81 @@
 #define TURNTABLE 0
 #define TRAVERSER 1
 
+// Turntable rotation directions for a move, ROTATE_DEFAULT follows ROTATE_FORWARD_ONLY/ROTATE_REVERSE_ONLY.
+#define ROTATE_DEFAULT 0
+#define ROTATE_FORWARD 1
+#define ROTATE_REVERSE 2
+
+// Ensure the stepper acceleration ramp engines also have a value to test.
+#define FLOAT_RAMP 0
+#define FIXED_RAMP 1
+#define TABLE_RAMP 2
+#define SCURVE_RAMP 3
+
+// I2C extended commands are a command code followed by its parameters. They are never 3 bytes long, so can't be
+// mistaken for the original <steps MSB, steps LSB, activity> move command.
+#define I2C_PROTOCOL_VERSION 5                      // Reported in the status frame and registers, the commands supported.
+#define I2C_COMMAND_STATUS_MODE 0x01                // Select the reply to I2C reads, followed by I2C_STATUS_BASIC/EXTENDED.
+#define I2C_COMMAND_MOVE 0x02                       // Followed by a 4 byte signed step position MSB first, then the activity.
+#define I2C_COMMAND_REGISTERS 0x03                  // Followed by a register number and values to write, selects register reads.
+#define I2C_COMMAND_BATCH 0x04                      // Followed by up to I2C_COMMAND_QUEUE_SIZE original 3 byte commands.
+#define I2C_COMMAND_FRAMED 0x05                     // Followed by a sequence number, any other command, then a CRC-8.
+#define I2C_COMMAND_POSITION 0x06                   // Followed by the index of a stored position to move to.
+
+// Replies to I2C reads, the first byte is always 1 while moving or 0 once finished.
+#define I2C_STATUS_BASIC 0                          // Only the moving byte, the default for existing device drivers.
+#define I2C_STATUS_EXTENDED 1                       // The full status frame, see updateStatusFrame().
+#define I2C_STATUS_REGISTERS 2                      // Registers from the last selected register onwards.
+#define I2C_STATUS_FRAME_SIZE 14
+
+// I2C registers, each 16 bits sent MSB first. 32 bit values span two registers, high half first.
+#define I2C_REGISTER_STATUS 0                       // Read only, state in the high byte and flags in the low byte.
+#define I2C_REGISTER_ERROR 1                        // Read only, last error in the high byte and change counter in the low byte.
+#define I2C_REGISTER_POSITION 2                     // Read only, current position in stepper steps, 2 registers.
+#define I2C_REGISTER_TARGET 4                       // Target position in stepper steps, 2 registers, writing the low half moves.
+#define I2C_REGISTER_SPEED 6                        // Read only, current signed speed in steps per second.
+#define I2C_REGISTER_MAX_SPEED 7                    // Maximum speed in steps per second.
+#define I2C_REGISTER_ACCELERATION 8                 // Acceleration in steps per second per second.
+#define I2C_REGISTER_PHASE 9                        // Phase, 0 or 1, also used for moves via I2C_REGISTER_TARGET.
+#define I2C_REGISTER_LED 10                         // LED activity, 4 to 7.
+#define I2C_REGISTER_ACCESSORY 11                   // Accessory output, 0 or 1.
+#define I2C_REGISTER_FULL_TURN_STEPS 12             // Read only, calibrated full turn or traverser steps, 2 registers.
+#define I2C_REGISTER_VERSION 14                     // Read only, I2C_PROTOCOL_VERSION.
+#define I2C_REGISTER_SEQUENCE 15                    // Read only, sequence number of the last framed command acted on.
+#define I2C_REGISTER_COUNT 16
+#define I2C_REGISTERS_WRITABLE ((3U << I2C_REGISTER_TARGET) | (1U << I2C_REGISTER_MAX_SPEED) | \
+                                (1U << I2C_REGISTER_ACCELERATION) | (1U << I2C_REGISTER_PHASE) | \
+                                (1U << I2C_REGISTER_LED) | (1U << I2C_REGISTER_ACCESSORY))
+
+// Turntable states reported in the extended status frame.
+#define TURNTABLE_STATE_IDLE 0
+#define TURNTABLE_STATE_MOVING 1
+#define TURNTABLE_STATE_HOMING 2
+#define TURNTABLE_STATE_CALIBRATING 3
+
+// Flags reported in the extended status frame.
+#define STATUS_FLAG_MOVING 0x01
+#define STATUS_FLAG_HOMED 0x02
+#define STATUS_FLAG_HOME_FAILED 0x04
+#define STATUS_FLAG_CALIBRATING 0x08
+#define STATUS_FLAG_CALIBRATED 0x10
+#define STATUS_FLAG_PHASE_SWITCHED 0x20
+#define STATUS_FLAG_COMMAND_PENDING 0x40
+#define STATUS_FLAG_ATTENTION 0x80                  // ATTENTION_PIN is pulled low.
+
+// Errors reported in the extended status frame, the last error is kept until the next accepted command.
+#define TURNTABLE_ERROR_NONE 0
+#define TURNTABLE_ERROR_HOMING_FAILED 1
+#define TURNTABLE_ERROR_CALIBRATION_FAILED 2
+#define TURNTABLE_ERROR_INVALID_COMMAND 3
+#define TURNTABLE_ERROR_LIMIT_REACHED 4
+
+// Ensure the LOG_LEVEL options have a value to test.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
 // If we haven't got a custom config.h, use the example.
 #if __has_include ( "config.h")
   #include "config.h"
@@ -53,6 +128,66 @@
 #define STEPPER_ACCELERATION 25                     // Set default acceleration if not defined.
 #endif
 
+#ifndef HOMING_SEEK_SPEED
+#define HOMING_SEEK_SPEED STEPPER_MAX_SPEED         // Speed to find the home sensor with HOMING_APPROACH_SPEED.
+#endif
+
+#ifndef HOMING_BACKOFF_STEPS
+#define HOMING_BACKOFF_STEPS 50                     // Steps to back off the home sensor before approaching slowly.
+#endif
+
+#if defined(STEPPER_TIMER_INTERRUPT)
+#ifndef STEPPER_RAMP_ENGINE
+#define STEPPER_RAMP_ENGINE FIXED_RAMP              // Steps from the timer interrupt need a ramp without floats.
+#elif STEPPER_RAMP_ENGINE != FIXED_RAMP && STEPPER_RAMP_ENGINE != TABLE_RAMP
+#error STEPPER_TIMER_INTERRUPT requires STEPPER_RAMP_ENGINE to be FIXED_RAMP or TABLE_RAMP
+#endif
+#endif
+
+#ifndef STEPPER_RAMP_ENGINE
+#define STEPPER_RAMP_ENGINE FLOAT_RAMP              // Use the original floating point ramp if not defined.
+#endif
+
+#ifndef STEPPER_JERK
+#define STEPPER_JERK (STEPPER_ACCELERATION * 4)     // Rate of change of acceleration for SCURVE_RAMP.
+#endif
+
+#ifndef STEPPER_RAMP_TABLE_SIZE
+#define STEPPER_RAMP_TABLE_SIZE 64                  // Entries in the TABLE_RAMP interval table, 2 bytes each.
+#endif
+
+#ifndef I2C_COMMAND_QUEUE_SIZE
+#define I2C_COMMAND_QUEUE_SIZE 8                    // I2C commands waiting to execute, must be a power of 2.
+#endif
+
+#ifndef POSITION_TABLE_SIZE
+#define POSITION_TABLE_SIZE 16                      // Positions stored in EEPROM, 5 bytes each.
+#endif
+
+#ifndef POSITION_RECORD_SLOTS
+#define POSITION_RECORD_SLOTS 8                     // Slots used in turn for the saved position, 12 bytes each.
+#endif
+
+#ifndef POSITION_SAVE_DELAY
+#define POSITION_SAVE_DELAY 2000                    // Time in ms stopped before the position is saved.
+#endif
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG                   // Include all messages if not defined, debug ones still need <D>.
+#endif
+
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 256                         // Bytes of output waiting to be sent, must be a power of 2.
+#endif
+
+#ifndef TELEMETRY_INTERVAL
+#define TELEMETRY_INTERVAL 100                      // Default time between <W> telemetry samples in ms.
+#endif
+
+#ifndef DCC_INPUT_PIN
+#define DCC_INPUT_PIN 2                             // DCC signal input for the accessory decoder, must support interrupts.
+#endif
+
 #ifndef SANITY_STEPS
 #define SANITY_STEPS 10000                          // Define sanity steps if not in config.h.
 #endif
@@ -77,6 +212,18 @@
 #endif
 #endif
 
+#ifndef SENSOR_SAMPLE_INTERVAL
+#define SENSOR_SAMPLE_INTERVAL 500                  // Define the time between sensor samples in us if not in config.h
+#endif
+
+#ifndef SENSOR_FILTER_SAMPLES                       // Define the samples needed for a sensor to change if not in config.h
+#if DEBOUNCE_DELAY * 1000L / SENSOR_SAMPLE_INTERVAL > 2
+#define SENSOR_FILTER_SAMPLES (DEBOUNCE_DELAY * 1000L / SENSOR_SAMPLE_INTERVAL)   // Cover the debounce delay
+#else
+#define SENSOR_FILTER_SAMPLES 2                     // Always ignore single sample glitches
+#endif
+#endif
+
 #ifndef STEPPER_GEARING_FACTOR
 #define STEPPER_GEARING_FACTOR 1                    // Define the gearing factor to default of 1 if not in config.h
 #endif
@@ -84,6 +231,14 @@
 // Define current version of EEPROM configuration
 #define EEPROM_VERSION 2
 
+// The stored position table follows the step count in EEPROM, each entry has flags for the phase and direction.
+#define POSITION_TABLE_ADDRESS 16
+#define POSITION_FLAG_PHASE 0x01
+#define POSITION_FLAG_DIRECTION 0x06                // ROTATE_DEFAULT/FORWARD/REVERSE shifted left by 1.
+
+// The position saved with PERSIST_POSITION follows the position table.
+#define POSITION_RECORD_ADDRESS (POSITION_TABLE_ADDRESS + 4 + POSITION_TABLE_SIZE * 5)
+
 #if defined(ROTATE_FORWARD_ONLY) && defined(ROTATE_REVERSE_ONLY)
 #error Both ROTATE_FORWARD_ONLY and ROTATE_REVERSE_ONLY defined, please only define one or the other
 #endif
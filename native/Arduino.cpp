@@ -0,0 +1,384 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <EEPROM.h>
+#include <avr/wdt.h>
+#include "Simulator.h"
+
+HardwareSerial Serial;
+TwoWire Wire;
+EEPROMClass EEPROM;
+
+#define SERIAL_BUFFER_SIZE 1024
+#define MAX_INTERRUPTS NUM_DIGITAL_PINS                 // Every pin supports interrupts, as on ESP32.
+#define MAX_SCHEDULED_INPUTS 2048
+#define SERIAL_TX_BUFFER_SIZE 64                        // As the AVR HardwareSerial transmit buffer.
+#define SERIAL_BYTE_MICROS 87                           // 10 bits at 115200 baud.
+
+struct ScheduledInput {
+  unsigned long time;
+  uint8_t pin;
+  uint8_t level;
+};
+
+static unsigned long simTime = 0;                       // Virtual time in microseconds.
+static uint8_t pinModes[NUM_DIGITAL_PINS];
+static uint8_t pinOutputs[NUM_DIGITAL_PINS];
+static uint8_t pinInputs[NUM_DIGITAL_PINS];
+static bool pinDriven[NUM_DIGITAL_PINS];
+static void (*pinWriteHandler)(uint8_t, uint8_t) = nullptr;
+static void (*interruptHandlers[MAX_INTERRUPTS])() = {};
+static int interruptModes[MAX_INTERRUPTS];
+static bool interruptPending[MAX_INTERRUPTS];
+static bool interruptsEnabled = true;
+static ScheduledInput scheduledInputs[MAX_SCHEDULED_INPUTS];
+static size_t scheduledHead = 0;
+static size_t scheduledCount = 0;
+static bool applyingInput = false;
+static char serialBuffer[SERIAL_BUFFER_SIZE];
+static size_t serialHead = 0;
+static size_t serialTail = 0;
+static unsigned long serialTxEnd = 0;                   // Time the last byte written finishes sending.
+static bool resetRequested = false;
+
+/*=============================================================
+ * Pins
+=============================================================*/
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < NUM_DIGITAL_PINS) {
+    pinModes[pin] = mode;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin >= NUM_DIGITAL_PINS) {
+    return;
+  }
+  pinOutputs[pin] = value ? HIGH : LOW;
+  if (pinWriteHandler) {
+    pinWriteHandler(pin, pinOutputs[pin]);
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= NUM_DIGITAL_PINS) {
+    return LOW;
+  }
+  if (pinModes[pin] == OUTPUT) {
+    return pinOutputs[pin];
+  }
+  if (pinDriven[pin]) {
+    return pinInputs[pin];
+  }
+  return pinModes[pin] == INPUT_PULLUP ? HIGH : LOW;
+}
+
+int digitalPinToInterrupt(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? pin : -1;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode) {
+  if (interrupt < MAX_INTERRUPTS) {
+    interruptHandlers[interrupt] = handler;
+    interruptModes[interrupt] = mode;
+  }
+}
+
+void detachInterrupt(uint8_t interrupt) {
+  if (interrupt < MAX_INTERRUPTS) {
+    interruptHandlers[interrupt] = nullptr;
+  }
+}
+
+void noInterrupts() {
+  interruptsEnabled = false;
+}
+
+void interrupts() {
+  interruptsEnabled = true;
+  // Interrupts that happened while disabled are handled now, as the hardware would.
+  for (uint8_t interrupt = 0; interrupt < MAX_INTERRUPTS; interrupt++) {
+    if (interruptPending[interrupt]) {
+      interruptPending[interrupt] = false;
+      if (interruptHandlers[interrupt]) {
+        interruptHandlers[interrupt]();
+      }
+    }
+  }
+}
+
+/*=============================================================
+ * Time
+=============================================================*/
+// Move time forward, applying any scheduled inputs at their exact time on the way.
+static void advanceTo(unsigned long end) {
+  while (!applyingInput && scheduledHead < scheduledCount && (long)(scheduledInputs[scheduledHead].time - end) <= 0) {
+    ScheduledInput &input = scheduledInputs[scheduledHead++];
+    if ((long)(input.time - simTime) > 0) {
+      simTime = input.time;
+    }
+    applyingInput = true;
+    simSetInput(input.pin, input.level);
+    applyingInput = false;
+  }
+  if (scheduledHead == scheduledCount) {
+    scheduledHead = scheduledCount = 0;
+  }
+  if ((long)(end - simTime) > 0) {
+    simTime = end;
+  }
+}
+
+unsigned long micros() {
+  // Each call takes a little time, so polling loops always make progress.
+  advanceTo(simTime + 1);
+  return simTime;
+}
+
+unsigned long millis() {
+  return micros() / 1000;
+}
+
+void delay(unsigned long ms) {
+  advanceTo(simTime + ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  advanceTo(simTime + us);
+}
+
+void yield() {}
+
+void wdt_enable(int) {
+  resetRequested = true;
+}
+
+/*=============================================================
+ * Serial
+=============================================================*/
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::print(long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%ld", n);
+  return write(buffer);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%lu", n);
+  return write(buffer);
+}
+
+size_t Print::print(double n, int digits) {
+  char buffer[40];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+  return write(buffer);
+}
+
+// Bytes written that haven't finished sending yet.
+static int serialTxQueued() {
+  long remaining = serialTxEnd - simTime;
+  if (remaining <= 0) {
+    return 0;
+  }
+  return (remaining + SERIAL_BYTE_MICROS - 1) / SERIAL_BYTE_MICROS;
+}
+
+int HardwareSerial::availableForWrite() {
+  return SERIAL_TX_BUFFER_SIZE - 1 - serialTxQueued();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  // Like the real thing, wait for space in the transmit buffer.
+  if (serialTxQueued() >= SERIAL_TX_BUFFER_SIZE - 1) {
+    advanceTo(serialTxEnd - (SERIAL_TX_BUFFER_SIZE - 2) * SERIAL_BYTE_MICROS);
+  }
+  if ((long)(serialTxEnd - simTime) < 0) {
+    serialTxEnd = simTime;
+  }
+  serialTxEnd += SERIAL_BYTE_MICROS;
+  // Drop the carriage return from println() so output reads cleanly on a terminal.
+  if (c != '\r') {
+    putchar(c);
+  }
+  return 1;
+}
+
+int HardwareSerial::available() {
+  return serialHead - serialTail;
+}
+
+int HardwareSerial::read() {
+  if (serialTail == serialHead) {
+    return -1;
+  }
+  return serialBuffer[serialTail++];
+}
+
+/*=============================================================
+ * Wire
+=============================================================*/
+void TwoWire::begin(uint8_t i2cAddress) {
+  address = i2cAddress;
+  enabled = true;
+}
+
+void TwoWire::end() {
+  enabled = false;
+}
+
+void TwoWire::onReceive(void (*handler)(int)) {
+  receiveHandler = handler;
+}
+
+void TwoWire::onRequest(void (*handler)()) {
+  requestHandler = handler;
+}
+
+int TwoWire::available() {
+  return rxLength - rxIndex;
+}
+
+int TwoWire::read() {
+  return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLength >= WIRE_BUFFER_SIZE) {
+    return 0;
+  }
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+/*=============================================================
+ * Simulator controls
+=============================================================*/
+unsigned long simMicros() {
+  return simTime;
+}
+
+void simAdvance(unsigned long us) {
+  advanceTo(simTime + us);
+}
+
+void simSetInput(uint8_t pin, uint8_t level) {
+  if (pin >= NUM_DIGITAL_PINS) {
+    return;
+  }
+  uint8_t lastLevel = digitalRead(pin);
+  pinInputs[pin] = level ? HIGH : LOW;
+  pinDriven[pin] = true;
+  int interrupt = digitalPinToInterrupt(pin);
+  if (interrupt < 0 || !interruptHandlers[interrupt] || lastLevel == pinInputs[pin]) {
+    return;
+  }
+  int mode = interruptModes[interrupt];
+  if (mode == CHANGE || (mode == RISING && pinInputs[pin]) || (mode == FALLING && !pinInputs[pin])) {
+    if (interruptsEnabled) {
+      interruptHandlers[interrupt]();
+    } else {
+      interruptPending[interrupt] = true;
+    }
+  }
+}
+
+bool simScheduleInput(uint8_t pin, uint8_t level, unsigned long time) {
+  if (scheduledCount >= MAX_SCHEDULED_INPUTS) {
+    return false;
+  }
+  scheduledInputs[scheduledCount++] = {time, pin, level};
+  return true;
+}
+
+uint8_t simGetOutput(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? pinOutputs[pin] : LOW;
+}
+
+void simOnPinWrite(void (*handler)(uint8_t pin, uint8_t value)) {
+  pinWriteHandler = handler;
+}
+
+void simSerialInput(const char *text) {
+  if (serialTail == serialHead) {
+    serialHead = serialTail = 0;
+  }
+  while (*text && serialHead < SERIAL_BUFFER_SIZE) {
+    serialBuffer[serialHead++] = *text++;
+  }
+}
+
+bool simI2CWrite(uint8_t address, const uint8_t *data, uint8_t length) {
+  if (!Wire.enabled || Wire.address != address || length > WIRE_BUFFER_SIZE) {
+    return false;
+  }
+  memcpy(Wire.rxBuffer, data, length);
+  Wire.rxLength = length;
+  Wire.rxIndex = 0;
+  if (Wire.receiveHandler) {
+    Wire.receiveHandler(length);
+  }
+  return true;
+}
+
+uint8_t simI2CRead(uint8_t address, uint8_t *data, uint8_t length) {
+  if (!Wire.enabled || Wire.address != address) {
+    return 0;
+  }
+  Wire.txLength = 0;
+  if (Wire.requestHandler) {
+    Wire.requestHandler();
+  }
+  uint8_t count = Wire.txLength < length ? Wire.txLength : length;
+  memcpy(data, Wire.txBuffer, count);
+  return count;
+}
+
+bool simLoadEEPROM(const char *fileName) {
+  FILE *file = fopen(fileName, "rb");
+  if (!file) {
+    return false;
+  }
+  size_t count = fread(EEPROM.data, 1, EEPROM_SIZE, file);
+  fclose(file);
+  return count == EEPROM_SIZE;
+}
+
+bool simSaveEEPROM(const char *fileName) {
+  FILE *file = fopen(fileName, "wb");
+  if (!file) {
+    return false;
+  }
+  size_t count = fwrite(EEPROM.data, 1, EEPROM_SIZE, file);
+  fclose(file);
+  return count == EEPROM_SIZE;
+}
+
+bool simResetRequested() {
+  return resetRequested;
+}
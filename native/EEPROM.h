@@ -0,0 +1,47 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * In-memory EEPROM for the native environment, the same size
+ * as a Nano/Uno and erased to 0xFF. Simulator.h can load and
+ * save it to a file so calibration persists between runs.
+=============================================================*/
+
+#ifndef NATIVE_EEPROM_H
+#define NATIVE_EEPROM_H
+
+#include <Arduino.h>
+
+#define EEPROM_SIZE 1024
+
+class EEPROMClass {
+public:
+  EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+  uint8_t read(int address) { return data[address]; }
+  void write(int address, uint8_t value) { data[address] = value; writes++; }
+  void update(int address, uint8_t value) { if (data[address] != value) write(address, value); }
+  uint16_t length() { return EEPROM_SIZE; }
+
+  uint8_t data[EEPROM_SIZE];
+  unsigned long writes;         // Number of byte writes, to check EEPROM wear.
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * This file contains the controls for the simulated hardware
+ * behind the native Arduino API, used to drive the firmware
+ * from a host program.
+ *
+ * Time is virtual: it only moves forward when the firmware
+ * calls micros(), millis() or a delay, or when simAdvance()
+ * is called, so runs are repeatable and much faster than real
+ * time.
+=============================================================*/
+
+#ifndef NATIVE_SIMULATOR_H
+#define NATIVE_SIMULATOR_H
+
+#include <Arduino.h>
+
+// Virtual time in microseconds, and advance it to account for time spent outside the firmware.
+unsigned long simMicros();
+void simAdvance(unsigned long us);
+
+// Drive an input pin from outside, eg. a sensor. Attached interrupts on the pin are triggered.
+// Until an input is driven it reads HIGH with INPUT_PULLUP, and LOW otherwise.
+void simSetInput(uint8_t pin, uint8_t level);
+
+// Drive an input pin at a future time in microseconds, eg. to replay a signal. Changes must be
+// scheduled in time order, and are applied at exactly that time. Returns false if too many are waiting.
+bool simScheduleInput(uint8_t pin, uint8_t level, unsigned long time);
+
+// The level last written to an output pin.
+uint8_t simGetOutput(uint8_t pin);
+
+// Called after every digitalWrite(), eg. to follow the stepper outputs.
+void simOnPinWrite(void (*handler)(uint8_t pin, uint8_t value));
+
+// Queue text to be read from Serial.
+void simSerialInput(const char *text);
+
+// Act as the I2C controller. Returns false if the address isn't listening.
+bool simI2CWrite(uint8_t address, const uint8_t *data, uint8_t length);
+// Returns the number of bytes the peripheral sent, up to length.
+uint8_t simI2CRead(uint8_t address, uint8_t *data, uint8_t length);
+
+// Load or save the EEPROM contents, returns false if the file can't be used.
+bool simLoadEEPROM(const char *fileName);
+bool simSaveEEPROM(const char *fileName);
+
+// True once the firmware has asked to reset via the watchdog.
+bool simResetRequested();
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * Simulated I2C peripheral for the native environment. The
+ * controller side is driven by simI2CWrite() and simI2CRead()
+ * in Simulator.h, which call the registered event handlers.
+=============================================================*/
+
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include <Arduino.h>
+
+#define WIRE_BUFFER_SIZE 32
+
+class TwoWire : public Stream {
+public:
+  void begin(uint8_t address);
+  void end();
+  void onReceive(void (*handler)(int));
+  void onRequest(void (*handler)());
+  int available();
+  int read();
+  size_t write(uint8_t data);
+  using Print::write;
+
+  // Used by the simulator to act as the I2C controller.
+  uint8_t address;
+  bool enabled;
+  void (*receiveHandler)(int);
+  void (*requestHandler)();
+  uint8_t rxBuffer[WIRE_BUFFER_SIZE];
+  uint8_t rxLength;
+  uint8_t rxIndex;
+  uint8_t txBuffer[WIRE_BUFFER_SIZE];
+  uint8_t txLength;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * This file runs the firmware on a host computer against a
+ * simulated turntable or traverser. The stepper outputs are
+ * followed to track the physical position, which drives the
+ * home and limit sensors, so homing, calibration and moves run
+ * exactly as they would on the bench.
+ *
+ * Usage: .pio/build/native/program [options] [commands]
+ *   -t ms     Simulated time to run for (default 60000)
+ *   -s steps  Steps in a full turn, or the traverser travel (default 4096)
+ *   -p steps  Starting position from the home sensor (default a quarter of -s)
+ *   -w steps  Width of the home sensor (default 20)
+ *   -l us     Time taken by each pass through loop() (default 20)
+ *   -e file   Load the EEPROM from file, and save it back on exit
+ *   -b us     Sensors chatter randomly for this long after each change, like switch bounce (default 0)
+ *   -g ms     Sensors glitch to the wrong state for 100us about this often (default 0, none)
+ * Commands run at the given simulated time, or at the start:
+ *   [@ms:]<X>                 Serial command, eg. "@2000:<M 1000 0>"
+ *   [@ms:]i2c:steps,activity  I2C move command, eg. "@5000:i2c:2048,0"
+ *   [@ms:]i2cw:byte,...       I2C write of the given bytes, eg. "i2cw:1,1"
+ *   [@ms:]i2cr:count          I2C read, printing the bytes received, eg. "@9000:i2cr:14"
+ *   [@ms:]dcc:address,thrown  DCC accessory packet on DCC_INPUT_PIN, eg. "@5000:dcc:101,1"
+ *
+ * The unit tests in test/ provide their own main(), so this
+ * file is left out when PlatformIO builds them.
+=============================================================*/
+
+#if !defined(PIO_UNIT_TESTING)
+
+#include "../EX-Turntable.ino"
+#include <EEPROM.h>
+#include "Simulator.h"
+
+#define MAX_COMMANDS 32
+#define GLITCH_MICROS 100
+
+// The stepper outputs of the standard stepper definitions.
+template <class Stepper>
+struct StepperOutputs {
+  static const bool known = false;
+};
+
+template <uint8_t Interface, uint8_t Pin1, uint8_t Pin2, uint8_t Pin3, uint8_t Pin4, class Base>
+struct StepperOutputs<DriverStepper<Interface, Pin1, Pin2, Pin3, Pin4, Base> > {
+  static const bool known = true;
+  static const uint8_t interface = Interface;
+  static const uint8_t pin1 = Pin1;
+  static const uint8_t pin2 = Pin2;
+  static const uint8_t pin3 = Pin3;
+  static const uint8_t pin4 = Pin4;
+};
+
+typedef StepperOutputs<TurntableStepper> Outputs;
+static_assert(Outputs::known, "The native build needs STEPPER_DRIVER to be one of the standard stepper definitions");
+
+struct Command {
+  unsigned long time;
+  const char *text;
+};
+
+static long physicalPosition;         // Steps from the home sensor.
+static long turnSteps = 4096;
+static long sensorWidth = 20;
+static int8_t lastPhase = -1;
+static unsigned long bounceTime = 0;
+static unsigned long glitchInterval = 0;
+static uint32_t noiseSeed = 1;
+
+// The noise added to a sensor input.
+struct SensorNoise {
+  bool started;
+  bool active;                        // State without noise.
+  unsigned long changeTime;           // Time of the last change without noise.
+  unsigned long nextGlitch;
+};
+
+static SensorNoise homeNoise;
+static SensorNoise limitNoise;
+
+// Coil patterns of AccelStepper step8() and step4(), indexed by step.
+static const uint8_t halfStepPhases[8] = {0b0001, 0b0101, 0b0100, 0b0110, 0b0010, 0b1010, 0b1000, 0b1001};
+static const uint8_t fullStepPhases[4] = {0b0101, 0b0110, 0b1010, 0b1001};
+
+// Follow the stepper outputs to move the simulated turntable.
+static void onPinWrite(uint8_t pin, uint8_t value) {
+  if (Outputs::interface == AccelStepper::DRIVER) {
+    if (pin == Outputs::pin1 && value == HIGH) {
+      physicalPosition += simGetOutput(Outputs::pin2) ? 1 : -1;
+    }
+    return;
+  }
+  if (pin != Outputs::pin1 && pin != Outputs::pin2 && pin != Outputs::pin3 && pin != Outputs::pin4) {
+    return;
+  }
+  uint8_t mask = simGetOutput(Outputs::pin1) | (simGetOutput(Outputs::pin2) << 1) |
+                 (simGetOutput(Outputs::pin3) << 2) | (simGetOutput(Outputs::pin4) << 3);
+  bool halfStep = Outputs::interface == AccelStepper::HALF4WIRE;
+  const uint8_t *phases = halfStep ? halfStepPhases : fullStepPhases;
+  int8_t count = halfStep ? 8 : 4;
+  for (int8_t phase = 0; phase < count; phase++) {
+    if (phases[phase] != mask) {
+      continue;
+    }
+    // Pins are written one at a time, so only act on complete coil patterns.
+    if (lastPhase >= 0) {
+      int8_t change = (phase - lastPhase + count) % count;
+      if (change == 1) {
+        physicalPosition++;
+      } else if (change == count - 1) {
+        physicalPosition--;
+      }
+    }
+    lastPhase = phase;
+    return;
+  }
+}
+
+static uint32_t noiseRandom() {
+  noiseSeed = noiseSeed * 1103515245UL + 12345;
+  return noiseSeed >> 16;
+}
+
+// Add the bounce and glitches asked for to a sensor state.
+static bool addNoise(SensorNoise &noise, bool active) {
+  unsigned long now = simMicros();
+  if (!noise.started) {
+    // Start settled rather than bouncing.
+    noise.started = true;
+    noise.active = active;
+    noise.changeTime = now - bounceTime;
+  }
+  if (active != noise.active) {
+    noise.active = active;
+    noise.changeTime = now;
+  }
+  if (now - noise.changeTime < bounceTime) {
+    return noiseRandom() & 1;
+  }
+  if (glitchInterval && (long)(now - noise.nextGlitch) >= 0) {
+    if (now - noise.nextGlitch < GLITCH_MICROS) {
+      return !active;
+    }
+    noise.nextGlitch = now + glitchInterval * 500 + noiseRandom() % (glitchInterval * 1000);
+  }
+  return active;
+}
+
+// Set the sensors from the physical position.
+static void updateSensors() {
+#if TURNTABLE_EX_MODE == TRAVERSER
+  bool homeActive = addNoise(homeNoise, physicalPosition >= 0);
+  bool limitActive = addNoise(limitNoise, physicalPosition <= -turnSteps);
+  simSetInput(HOME_SENSOR_PIN, homeActive ? HOME_SENSOR_ACTIVE_STATE : !HOME_SENSOR_ACTIVE_STATE);
+  simSetInput(LIMIT_SENSOR_PIN, limitActive ? LIMIT_SENSOR_ACTIVE_STATE : !LIMIT_SENSOR_ACTIVE_STATE);
+#else
+  long angle = ((physicalPosition % turnSteps) + turnSteps) % turnSteps;
+  bool homeActive = addNoise(homeNoise, angle < sensorWidth);
+  simSetInput(HOME_SENSOR_PIN, homeActive ? HOME_SENSOR_ACTIVE_STATE : !HOME_SENSOR_ACTIVE_STATE);
+#endif
+}
+
+#if defined(DCC_ACCESSORY_ADDRESS)
+// Replay a basic accessory packet on the DCC input with nominal timings, twice as a command station would.
+static void sendDCCAccessory(unsigned address, bool thrown) {
+  static uint8_t level = LOW;
+  static unsigned long time = 0;
+  unsigned decoder = (address - 1) / 4 + 1;
+  uint8_t packet[3];
+  packet[0] = 0x80 | (decoder & 0x3F);
+  packet[1] = 0x80 | ((~decoder >> 2) & 0x70) | 0x08 | (((address - 1) % 4) << 1) | (thrown ? 1 : 0);
+  packet[2] = packet[0] ^ packet[1];
+  if ((long)(time - simMicros()) < 0) {
+    time = simMicros() + 10;
+  }
+  auto sendBit = [&](bool one) {
+    for (uint8_t half = 0; half < 2; half++) {
+      level = !level;
+      simScheduleInput(DCC_INPUT_PIN, level, time);
+      time += one ? 58 : 100;
+    }
+  };
+  for (uint8_t repeat = 0; repeat < 2; repeat++) {
+    for (uint8_t i = 0; i < 14; i++) {
+      sendBit(true);
+    }
+    for (uint8_t byte = 0; byte < 3; byte++) {
+      sendBit(false);
+      for (int8_t bit = 7; bit >= 0; bit--) {
+        sendBit(packet[byte] & (1 << bit));
+      }
+    }
+    sendBit(true);
+  }
+}
+#endif
+
+static void runCommand(const char *text) {
+  if (strncmp(text, "i2c:", 4) == 0) {
+    long steps = 0;
+    int activity = 0;
+    sscanf(text + 4, "%ld,%d", &steps, &activity);
+    uint8_t data[3] = {(uint8_t)(steps >> 8), (uint8_t)steps, (uint8_t)activity};
+    if (!simI2CWrite(I2C_ADDRESS, data, sizeof(data))) {
+      printf("SIM: I2C write not acknowledged\n");
+    }
+  } else if (strncmp(text, "i2cw:", 5) == 0) {
+    uint8_t data[WIRE_BUFFER_SIZE];
+    uint8_t length = 0;
+    const char *value = text + 5;
+    while (*value && length < sizeof(data)) {
+      char *end;
+      data[length++] = (uint8_t)strtoul(value, &end, 0);
+      if (end == value) {
+        break;
+      }
+      value = (*end == ',') ? end + 1 : end;
+    }
+    if (!simI2CWrite(I2C_ADDRESS, data, length)) {
+      printf("SIM: I2C write not acknowledged\n");
+    }
+  } else if (strncmp(text, "i2cr:", 5) == 0) {
+    uint8_t data[WIRE_BUFFER_SIZE];
+    int count = atoi(text + 5);
+    uint8_t received = simI2CRead(I2C_ADDRESS, data, count < WIRE_BUFFER_SIZE ? count : WIRE_BUFFER_SIZE);
+    printf("SIM: I2C read %u bytes:", received);
+    for (uint8_t i = 0; i < received; i++) {
+      printf(" %02X", data[i]);
+    }
+    printf("\n");
+#if defined(DCC_ACCESSORY_ADDRESS)
+  } else if (strncmp(text, "dcc:", 4) == 0) {
+    unsigned address = 0;
+    int thrown = 1;
+    sscanf(text + 4, "%u,%d", &address, &thrown);
+    sendDCCAccessory(address, thrown);
+#endif
+  } else {
+    simSerialInput(text);
+  }
+}
+
+int main(int argc, char **argv) {
+  unsigned long runTime = 60000;
+  unsigned long loopTime = 20;
+  long startPosition = -1;
+  const char *eepromFile = nullptr;
+  Command commands[MAX_COMMANDS];
+  uint8_t commandCount = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc) {
+      const char *value = argv[++i];
+      switch (argv[i - 1][1]) {
+        case 't': runTime = strtoul(value, nullptr, 10); break;
+        case 's': turnSteps = atol(value); break;
+        case 'p': startPosition = atol(value); break;
+        case 'w': sensorWidth = atol(value); break;
+        case 'l': loopTime = strtoul(value, nullptr, 10); break;
+        case 'e': eepromFile = value; break;
+        case 'b': bounceTime = strtoul(value, nullptr, 10); break;
+        case 'g': glitchInterval = strtoul(value, nullptr, 10); break;
+        default:
+          fprintf(stderr, "Unknown option %s\n", argv[i - 1]);
+          return 1;
+      }
+    } else if (commandCount < MAX_COMMANDS) {
+      Command &command = commands[commandCount++];
+      command.time = 0;
+      command.text = argv[i];
+      if (argv[i][0] == '@') {
+        char *end;
+        command.time = strtoul(argv[i] + 1, &end, 10);
+        command.text = (*end == ':') ? end + 1 : end;
+      }
+    }
+  }
+
+  if (eepromFile && !simLoadEEPROM(eepromFile)) {
+    printf("SIM: Starting with erased EEPROM\n");
+  }
+#if TURNTABLE_EX_MODE == TRAVERSER
+  physicalPosition = startPosition >= 0 ? -startPosition : -turnSteps / 4;
+#else
+  physicalPosition = startPosition >= 0 ? startPosition : turnSteps / 4;
+#endif
+  homeNoise.nextGlitch = glitchInterval * 500 + noiseRandom() % (glitchInterval * 1000 + 1);
+  limitNoise.nextGlitch = glitchInterval * 500 + noiseRandom() % (glitchInterval * 1000 + 1);
+  simOnPinWrite(onPinWrite);
+  updateSensors();
+
+  setup();
+  unsigned long loops = 0;
+  while (simMicros() / 1000 < runTime && !simResetRequested()) {
+    unsigned long now = simMicros() / 1000;
+    for (uint8_t i = 0; i < commandCount; i++) {
+      if (commands[i].text && commands[i].time <= now) {
+        runCommand(commands[i].text);
+        commands[i].text = nullptr;
+      }
+    }
+    updateSensors();
+    loop();
+    simAdvance(loopTime);
+    loops++;
+  }
+
+  if (eepromFile) {
+    simSaveEEPROM(eepromFile);
+  }
+  printf("SIM: %lu ms, %lu loops, stepper position %ld, physical position %ld, EEPROM writes %lu%s\n",
+         simMicros() / 1000, loops, stepper.currentPosition(), physicalPosition, EEPROM.writes,
+         simResetRequested() ? ", reset requested" : "");
+  return 0;
+}
+
+#endif
@@ -9,6 +9,7 @@
 
 #include <Arduino.h>
 #include "AccelStepper.h"
+#include "DriverStepper.h"
 
 #define UNUSED_PIN 127
 
@@ -20,13 +21,13 @@
 
 
 #ifndef USE_RT_EX_TURNTABLE
-#define ULN2003_HALF_CW AccelStepper(AccelStepper::HALF4WIRE, A3, A1, A2, A0)
-#define ULN2003_HALF_CCW AccelStepper(AccelStepper::HALF4WIRE, A0, A2, A1, A3)
-#define ULN2003_FULL_CW AccelStepper(AccelStepper::FULL4WIRE, A3, A1, A2, A0)
-#define ULN2003_FULL_CCW AccelStepper(AccelStepper::FULL4WIRE, A0, A2, A1, A3)
-#define A4988 AccelStepper(AccelStepper::DRIVER, A0, A1)
+#define ULN2003_HALF_CW DriverStepper<AccelStepper::HALF4WIRE, A3, A1, A2, A0>()
+#define ULN2003_HALF_CCW DriverStepper<AccelStepper::HALF4WIRE, A0, A2, A1, A3>()
+#define ULN2003_FULL_CW DriverStepper<AccelStepper::FULL4WIRE, A3, A1, A2, A0>()
+#define ULN2003_FULL_CCW DriverStepper<AccelStepper::FULL4WIRE, A0, A2, A1, A3>()
+#define A4988 DriverStepper<AccelStepper::DRIVER, A0, A1>()
 #else
-#define A4988 AccelStepper(AccelStepper::DRIVER, STEPPER_STEP_PIN, STEPPER_DIR_PIN)  
+#define A4988 DriverStepper<AccelStepper::DRIVER, STEPPER_STEP_PIN, STEPPER_DIR_PIN>()  
 #endif
 
 #endif
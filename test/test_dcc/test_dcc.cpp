@@ -0,0 +1,262 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * Checks the DCC accessory decoder pairs half bits, rejects
+ * short preambles and bad error bytes, and decodes accessory
+ * addresses to the right commands. Edges are fed straight into
+ * the decoder's buffer, so no real DCC signal is needed.
+ * Run with: pio test -e native
+=============================================================*/
+
+#include <Arduino.h>
+#include <unity.h>
+#include "defines.h"
+#include "IOFunctions.h"
+#include "TurntableFunctions.h"
+#include "DCCFunctions.h"
+#include "Simulator.h"
+
+// Build the decoder here whether or not config.h enables it. The default is a high address so the upper address
+// bits in the second byte of the packet are used.
+#ifndef DCC_ACCESSORY_ADDRESS
+#define DCC_ACCESSORY_ADDRESS 1001
+#undef DCC_INPUT_PIN
+#define DCC_INPUT_PIN 255                           // Not used, setupDCC() isn't called.
+#endif
+
+struct Command {
+  long steps;
+  uint8_t activity;
+  int position;
+};
+
+static Command commands[8];
+static uint8_t commandCount = 0;
+
+// Record the commands the decoder sends rather than acting on them.
+static void recordCommand(long steps, uint8_t activity, uint8_t direction = ROTATE_DEFAULT) {
+  if (commandCount < 8) {
+    commands[commandCount++] = {steps, activity, -1};
+  }
+}
+
+static void recordPositionCommand(uint8_t index) {
+  if (commandCount < 8) {
+    commands[commandCount++] = {0, 0, index};
+  }
+}
+
+#define processCommand recordCommand
+#define processPositionCommand recordPositionCommand
+namespace dcc {
+#include "../../DCCFunctions.cpp"
+}
+#undef processCommand
+#undef processPositionCommand
+
+#define ONE_HALF 58
+#define ZERO_HALF 100
+
+// Adds the time between two edges, and decodes it as loop() would.
+static void sendHalf(uint8_t period) {
+  dcc::dccEdges[dcc::dccEdgeHead & (DCC_EDGE_BUFFER_SIZE - 1)] = period;
+  dcc::dccEdgeHead = dcc::dccEdgeHead + 1;
+  dcc::processDCC();
+}
+
+static void sendBit(uint8_t bit) {
+  sendHalf(bit ? ONE_HALF : ZERO_HALF);
+  sendHalf(bit ? ONE_HALF : ZERO_HALF);
+}
+
+// Sends a packet with the given preamble, the error byte must already be included.
+static void sendPacket(const uint8_t *bytes, uint8_t length, uint8_t preamble = 14) {
+  for (uint8_t i = 0; i < preamble; i++) {
+    sendBit(1);
+  }
+  for (uint8_t i = 0; i < length; i++) {
+    sendBit(0);
+    for (int8_t bit = 7; bit >= 0; bit--) {
+      sendBit((bytes[i] >> bit) & 0x01);
+    }
+  }
+  sendBit(1);
+}
+
+// Fills in a basic accessory packet 10AAAAAA 1AAA1DDT with its error byte.
+static void accessoryPacket(uint16_t address, bool thrown, uint8_t *bytes) {
+  uint16_t decoderAddress = (address - 1) / 4 + 1;
+  bytes[0] = 0x80 | (decoderAddress & 0x3F);
+  bytes[1] = 0x80 | ((~decoderAddress >> 2) & 0x70) | 0x08 | (((address - 1) & 0x03) << 1) | (thrown ? 1 : 0);
+  bytes[2] = bytes[0] ^ bytes[1];
+}
+
+static void sendAccessory(uint16_t address, bool thrown) {
+  uint8_t bytes[3];
+  accessoryPacket(address, thrown, bytes);
+  sendPacket(bytes, 3);
+}
+
+void setUp() {
+  commandCount = 0;
+  dcc::pendingHalf = -1;
+  dcc::resetDCC(0);
+  // Past the time identical packets are taken as repeats.
+  simAdvance(DCC_REPEAT_TIME * 1000UL);
+}
+
+void tearDown() {}
+
+// Each position address moves to its stored position, closed or thrown, leaving the phase to the position table.
+void test_dcc_position_addresses() {
+  sendAccessory(DCC_ACCESSORY_ADDRESS, false);
+  sendAccessory(DCC_ACCESSORY_ADDRESS + 5, true);
+  sendAccessory(DCC_ACCESSORY_ADDRESS + POSITION_TABLE_SIZE - 1, false);
+  TEST_ASSERT_EQUAL(3, commandCount);
+  TEST_ASSERT_EQUAL(0, commands[0].position);
+  TEST_ASSERT_EQUAL(5, commands[1].position);
+  TEST_ASSERT_EQUAL(POSITION_TABLE_SIZE - 1, commands[2].position);
+}
+
+// The addresses after the position table home, calibrate and switch the LED and accessory output, and
+// addresses either side of ours are ignored.
+void test_dcc_activity_addresses() {
+  uint16_t activities = DCC_ACCESSORY_ADDRESS + POSITION_TABLE_SIZE;
+  sendAccessory(DCC_ACCESSORY_ADDRESS - 1, true);
+  sendAccessory(activities, false);
+  sendAccessory(activities, true);
+  sendAccessory(activities + 1, true);
+  sendAccessory(activities + 2, true);
+  sendAccessory(activities + 2, false);
+  sendAccessory(activities + 3, true);
+  sendAccessory(activities + 3, false);
+  sendAccessory(activities + 4, true);
+  TEST_ASSERT_EQUAL(6, commandCount);
+  TEST_ASSERT_EQUAL(2, commands[0].activity);
+  TEST_ASSERT_EQUAL(3, commands[1].activity);
+  TEST_ASSERT_EQUAL(4, commands[2].activity);
+  TEST_ASSERT_EQUAL(7, commands[3].activity);
+  TEST_ASSERT_EQUAL(8, commands[4].activity);
+  TEST_ASSERT_EQUAL(9, commands[5].activity);
+}
+
+// Command stations repeat each packet, only the first is acted on until the repeat time has passed.
+void test_dcc_repeats_ignored() {
+  sendAccessory(DCC_ACCESSORY_ADDRESS, true);
+  sendAccessory(DCC_ACCESSORY_ADDRESS, true);
+  TEST_ASSERT_EQUAL(1, commandCount);
+  simAdvance(DCC_REPEAT_TIME * 1000UL);
+  sendAccessory(DCC_ACCESSORY_ADDRESS, true);
+  TEST_ASSERT_EQUAL(2, commandCount);
+}
+
+// Fewer than DCC_PREAMBLE_BITS preamble bits, a bad error byte, or the activate bit clear are all ignored.
+void test_dcc_preamble_and_error_byte() {
+  uint8_t bytes[3];
+  accessoryPacket(DCC_ACCESSORY_ADDRESS, true, bytes);
+  sendPacket(bytes, 3, DCC_PREAMBLE_BITS - 1);
+  TEST_ASSERT_EQUAL(0, commandCount);
+  bytes[2] ^= 0x04;
+  sendPacket(bytes, 3);
+  TEST_ASSERT_EQUAL(0, commandCount);
+  accessoryPacket(DCC_ACCESSORY_ADDRESS, true, bytes);
+  bytes[1] &= ~0x08;
+  bytes[2] = bytes[0] ^ bytes[1];
+  sendPacket(bytes, 3);
+  TEST_ASSERT_EQUAL(0, commandCount);
+  accessoryPacket(DCC_ACCESSORY_ADDRESS, true, bytes);
+  sendPacket(bytes, 3, DCC_PREAMBLE_BITS);
+  TEST_ASSERT_EQUAL(1, commandCount);
+}
+
+// A stray half bit before the preamble puts the decoder out of step, it must pair the halves up again. Stretched
+// zeros are still zeros.
+void test_dcc_half_bit_pairing() {
+  sendHalf(ZERO_HALF);
+  sendAccessory(DCC_ACCESSORY_ADDRESS, true);
+  TEST_ASSERT_EQUAL(1, commandCount);
+  sendHalf(ONE_HALF);
+  sendHalf(ZERO_HALF);
+  sendHalf(ONE_HALF);
+  sendAccessory(DCC_ACCESSORY_ADDRESS + 1, true);
+  TEST_ASSERT_EQUAL(2, commandCount);
+  // The preamble and every zero stretched to 150us halves.
+  uint8_t bytes[3];
+  accessoryPacket(DCC_ACCESSORY_ADDRESS + 2, true, bytes);
+  for (uint8_t i = 0; i < 14; i++) {
+    sendBit(1);
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    sendHalf(150);
+    sendHalf(150);
+    for (int8_t bit = 7; bit >= 0; bit--) {
+      uint8_t period = (bytes[i] >> bit) & 0x01 ? ONE_HALF : 150;
+      sendHalf(period);
+      sendHalf(period);
+    }
+  }
+  sendBit(1);
+  TEST_ASSERT_EQUAL(3, commandCount);
+  TEST_ASSERT_EQUAL(2, commands[2].position);
+}
+
+// A bit whose halves differ, or a glitch shorter than a 1, drops the packet, and the next one is still decoded.
+void test_dcc_bad_bits_drop_packet() {
+  uint8_t bytes[3];
+  accessoryPacket(DCC_ACCESSORY_ADDRESS, true, bytes);
+  for (uint8_t i = 0; i < 14; i++) {
+    sendBit(1);
+  }
+  sendBit(0);
+  sendHalf(ONE_HALF);
+  sendHalf(ZERO_HALF);
+  for (int8_t bit = 6; bit >= 0; bit--) {
+    sendBit((bytes[0] >> bit) & 0x01);
+  }
+  for (uint8_t i = 1; i < 3; i++) {
+    sendBit(0);
+    for (int8_t bit = 7; bit >= 0; bit--) {
+      sendBit((bytes[i] >> bit) & 0x01);
+    }
+  }
+  sendBit(1);
+  TEST_ASSERT_EQUAL(0, commandCount);
+  for (uint8_t i = 0; i < 14; i++) {
+    sendBit(1);
+  }
+  sendBit(0);
+  sendHalf(ONE_HALF);
+  sendHalf(20);
+  sendHalf(ONE_HALF - 20);
+  TEST_ASSERT_EQUAL(0, commandCount);
+  sendAccessory(DCC_ACCESSORY_ADDRESS, true);
+  TEST_ASSERT_EQUAL(1, commandCount);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_dcc_position_addresses);
+  RUN_TEST(test_dcc_activity_addresses);
+  RUN_TEST(test_dcc_repeats_ignored);
+  RUN_TEST(test_dcc_preamble_and_error_byte);
+  RUN_TEST(test_dcc_half_bit_pairing);
+  RUN_TEST(test_dcc_bad_bits_drop_packet);
+  return UNITY_END();
+}
@@ -0,0 +1,149 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * Compares the FIXED_RAMP 24.8 fixed point acceleration ramp
+ * with the original floating point ramp for every combination
+ * of speeds 50, 200, 1000 and 4000 steps/s, accelerations 10,
+ * 25, 100 and 1000 steps/s/s, and moves of 100, 2000 and -5000
+ * steps. Run with: pio test -e native
+=============================================================*/
+
+#include <Arduino.h>
+#include <unity.h>
+#include "AccelStepper.h"
+
+#define FIXED_INTERVAL_CLAMP (0x7FFFFFFFUL >> 8)    // Longest interval in 24.8 fixed point, about 8.4s.
+
+static void noStep() {}
+
+// Steps straight through a move as the timer interrupt does, so no real time is needed.
+class RampStepper : public AccelStepper {
+public:
+  RampStepper(RampEngine engine, float speed, float acceleration) : AccelStepper(noStep, noStep) {
+    setRampEngine(engine);
+    setMaxSpeed(speed);
+    setAcceleration(acceleration);
+  }
+
+  unsigned long interval() {
+    return _stepInterval;
+  }
+
+  // Takes the step that is due, and returns the interval to the next or 0 at the target.
+  unsigned long nextStep() {
+    if (_direction == DIRECTION_CW) {
+      stepForward();
+    } else {
+      stepBackward();
+    }
+    return computeNewSpeed();
+  }
+
+  // The steps stop() would take to come to a halt from here.
+  long stepsToStop() {
+    RampStepper copy = *this;
+    copy.stop();
+    long steps = copy.distanceToGo();
+    return steps < 0 ? -steps : steps;
+  }
+};
+
+static const float speeds[] = {50.0, 200.0, 1000.0, 4000.0};
+static const float accelerations[] = {10.0, 25.0, 100.0, 1000.0};
+static const long distances[] = {100, 2000, -5000};
+
+void setUp() {}
+
+void tearDown() {}
+
+// Every interval of the fixed point ramp is within 0.2% (plus 1us of truncation) of the float ramp,
+// and steps-to-stop within 1% (plus 1 step), through acceleration, cruising and deceleration.
+void test_fixed_ramp_matches_float() {
+  char message[80];
+  for (float speed : speeds) {
+    for (float acceleration : accelerations) {
+      for (long distance : distances) {
+        RampStepper floatStepper(AccelStepper::RAMP_FLOAT, speed, acceleration);
+        RampStepper fixedStepper(AccelStepper::RAMP_FIXED, speed, acceleration);
+        floatStepper.moveTo(distance);
+        fixedStepper.moveTo(distance);
+        unsigned long floatInterval = floatStepper.interval();
+        unsigned long fixedInterval = fixedStepper.interval();
+        long steps = 0;
+        while (floatInterval) {
+          snprintf(message, sizeof(message), "speed %d accel %d distance %ld step %ld", (int)speed, (int)acceleration, distance, steps);
+          TEST_ASSERT_UINT32_WITHIN_MESSAGE(floatInterval / 500 + 1, floatInterval, fixedInterval, message);
+          long floatStop = floatStepper.stepsToStop();
+          TEST_ASSERT_INT_WITHIN_MESSAGE(floatStop / 100 + 1, floatStop, fixedStepper.stepsToStop(), message);
+          floatInterval = floatStepper.nextStep();
+          fixedInterval = fixedStepper.nextStep();
+          steps++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(0, fixedInterval);
+        TEST_ASSERT_EQUAL(distance, fixedStepper.currentPosition());
+        TEST_ASSERT_EQUAL(distance, floatStepper.currentPosition());
+      }
+    }
+  }
+}
+
+// With acceleration so low that c0 won't fit in 24.8 fixed point, the interval is clamped rather
+// than overflowing, and the ramp still speeds up and finishes the move.
+void test_fixed_ramp_clamps_first_interval() {
+  RampStepper stepper(AccelStepper::RAMP_FIXED, 10.0, 0.005);
+  stepper.moveTo(20);
+  unsigned long interval = stepper.interval();
+  TEST_ASSERT_EQUAL_UINT32(FIXED_INTERVAL_CLAMP, interval);
+  long steps = 0;
+  while (interval) {
+    unsigned long next = stepper.nextStep();
+    if (steps < 9) {
+      TEST_ASSERT_TRUE(next > 0 && next < interval);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(FIXED_INTERVAL_CLAMP, next);
+    interval = next;
+    steps++;
+  }
+  TEST_ASSERT_EQUAL(20, stepper.currentPosition());
+}
+
+// With maxSpeed so low that its interval won't fit in 24.8 fixed point, every step after the first
+// is at the clamp. The first is c0, as it is with the float ramp.
+void test_fixed_ramp_clamps_max_speed_interval() {
+  RampStepper floatStepper(AccelStepper::RAMP_FLOAT, 0.1, 1.0);
+  RampStepper stepper(AccelStepper::RAMP_FIXED, 0.1, 1.0);
+  floatStepper.moveTo(5);
+  stepper.moveTo(5);
+  TEST_ASSERT_UINT32_WITHIN(1, floatStepper.interval(), stepper.interval());
+  unsigned long interval = stepper.nextStep();
+  while (interval) {
+    TEST_ASSERT_EQUAL_UINT32(FIXED_INTERVAL_CLAMP, interval);
+    interval = stepper.nextStep();
+  }
+  TEST_ASSERT_EQUAL(5, stepper.currentPosition());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fixed_ramp_matches_float);
+  RUN_TEST(test_fixed_ramp_clamps_first_interval);
+  RUN_TEST(test_fixed_ramp_clamps_max_speed_interval);
+  return UNITY_END();
+}
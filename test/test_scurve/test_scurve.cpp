@@ -0,0 +1,165 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * Checks the SCURVE_RAMP jerk limited profile has no jumps in
+ * speed, including where the segments of the ramp join, and that
+ * it takes the time the profile says it should.
+ * Run with: pio test -e native
+=============================================================*/
+
+#include <Arduino.h>
+#include <unity.h>
+#include "AccelStepper.h"
+
+static void noStep() {}
+
+// Steps straight through a move as the timer interrupt does, so no real time is needed.
+class SCurveStepper : public AccelStepper {
+public:
+  SCurveStepper(float speed, float acceleration, float jerk) : AccelStepper(noStep, noStep) {
+    setRampEngine(RAMP_SCURVE);
+    setMaxSpeed(speed);
+    setAcceleration(acceleration);
+    setJerk(jerk);
+  }
+
+  unsigned long interval() {
+    return _stepInterval;
+  }
+
+  // Takes the step that is due, and returns the interval to the next or 0 at the target.
+  unsigned long nextStep() {
+    if (_direction == DIRECTION_CW) {
+      stepForward();
+    } else {
+      stepBackward();
+    }
+    return computeNewSpeed();
+  }
+};
+
+struct Profile {
+  float speed;
+  float acceleration;
+  float jerk;
+  long distance;
+};
+
+// Long moves reaching full speed with and without a constant acceleration segment, and moves too
+// short to reach full acceleration or full speed.
+static const Profile profiles[] = {
+  {200.0, 25.0, 10.0, 4096},
+  {200.0, 25.0, 100.0, 4096},
+  {1000.0, 500.0, 2000.0, 20000},
+  {1000.0, 500.0, 2000.0, -20000},
+  {4000.0, 2000.0, 50000.0, 50000},
+  {200.0, 25.0, 10.0, 300},
+  {1000.0, 500.0, 2000.0, 900},
+  {1000.0, 500.0, 2000.0, 20},
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+// The average speed over each step can only change from the step before by as much as the
+// acceleration allows in the time between the middle of the two steps, plus the 1us the interval is
+// rounded to, so a jump at a segment join or the change from accelerating to decelerating fails.
+void test_scurve_speed_is_continuous() {
+  char message[80];
+  for (const Profile &profile : profiles) {
+    SCurveStepper stepper(profile.speed, profile.acceleration, profile.jerk);
+    stepper.moveTo(profile.distance);
+    unsigned long interval = stepper.interval();
+    unsigned long lastInterval = interval;
+    float lastSpeed = 0.0;
+    long steps = 0;
+    while (interval) {
+      float speed = 1000000.0 / interval;
+      float allowed = profile.acceleration * (interval + lastInterval) / 2000000.0 + speed * speed / 1000000.0;
+      snprintf(message, sizeof(message), "speed %d accel %d jerk %d step %ld", (int)profile.speed,
+               (int)profile.acceleration, (int)profile.jerk, steps);
+      if (steps > 0) {
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(allowed * 1.05, lastSpeed, speed, message);
+      }
+      TEST_ASSERT_TRUE_MESSAGE(interval + 1 >= 1000000.0 / profile.speed, message);
+      lastSpeed = speed;
+      lastInterval = interval;
+      interval = stepper.nextStep();
+      steps++;
+    }
+    TEST_ASSERT_EQUAL(profile.distance, stepper.currentPosition());
+  }
+}
+
+// A move reaching full speed and acceleration takes as long as the profile segments add up to, so
+// the intervals found from one step to the next don't drift from the closed form.
+void test_scurve_move_time_matches_profile() {
+  for (const Profile &profile : profiles) {
+    float fullAccelSpeed = profile.acceleration * profile.acceleration / profile.jerk;
+    float jerkTime = profile.acceleration / profile.jerk;
+    float rampSteps = profile.speed / 2.0 * (profile.speed / profile.acceleration + jerkTime);
+    if (profile.speed < fullAccelSpeed || 2 * rampSteps > labs(profile.distance)) {
+      continue;
+    }
+    float rampTime = profile.speed / profile.acceleration + jerkTime;
+    float expected = 2.0 * rampTime + (labs(profile.distance) - 2.0 * rampSteps) / profile.speed;
+    SCurveStepper stepper(profile.speed, profile.acceleration, profile.jerk);
+    stepper.moveTo(profile.distance);
+    double total = 0.0;
+    unsigned long interval = stepper.interval();
+    while (interval) {
+      total += interval / 1000000.0;
+      interval = stepper.nextStep();
+    }
+    TEST_ASSERT_FLOAT_WITHIN(expected * 0.005, expected, total);
+  }
+}
+
+// Stopping part way up the ramp decelerates back down it without a jump in speed.
+void test_scurve_stop_while_accelerating() {
+  SCurveStepper stepper(1000.0, 500.0, 2000.0);
+  stepper.moveTo(20000);
+  unsigned long interval = stepper.interval();
+  for (int i = 0; i < 300; i++) {
+    interval = stepper.nextStep();
+  }
+  unsigned long lastInterval = interval;
+  float lastSpeed = 1000000.0 / interval;
+  stepper.stop();
+  interval = stepper.interval();
+  while (interval) {
+    float speed = 1000000.0 / interval;
+    float allowed = 500.0 * (interval + lastInterval) / 2000000.0 + speed * speed / 1000000.0;
+    TEST_ASSERT_FLOAT_WITHIN(allowed * 1.05, lastSpeed, speed);
+    lastSpeed = speed;
+    lastInterval = interval;
+    interval = stepper.nextStep();
+  }
+  TEST_ASSERT_EQUAL(stepper.targetPosition(), stepper.currentPosition());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_scurve_speed_is_continuous);
+  RUN_TEST(test_scurve_move_time_matches_profile);
+  RUN_TEST(test_scurve_stop_while_accelerating);
+  return UNITY_END();
+}
@@ -0,0 +1,144 @@
+/*
+ *  © 2026 Peter Cole
+ *
+ *  This file is part of EX-Turntable
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*=============================================================
+ * Checks the home sensor filter ignores bounce trains shorter
+ * and longer than SENSOR_FILTER_SAMPLES, and changes state once
+ * the sensor has settled, and that the edge latch debounces by
+ * DEBOUNCE_DELAY. Run with: pio test -e native
+=============================================================*/
+
+#include <Arduino.h>
+#include <unity.h>
+#include "defines.h"
+#include "SensorFunctions.h"
+#include "TurntableFunctions.h"
+#include "Simulator.h"
+
+#define ACTIVE HOME_SENSOR_ACTIVE_STATE
+#define INACTIVE !HOME_SENSOR_ACTIVE_STATE
+
+// Sets the home sensor pin, and takes the next sample as loop() would.
+static void sample(uint8_t level) {
+  simSetInput(HOME_SENSOR_PIN, level);
+  simAdvance(SENSOR_SAMPLE_INTERVAL);
+  processSensors();
+}
+
+// Alternates the sensor for the given number of samples, starting with level.
+static void bounce(uint8_t level, uint16_t samples) {
+  for (uint16_t i = 0; i < samples; i++) {
+    sample(i & 1 ? !level : level);
+  }
+}
+
+void setUp() {
+  simSetInput(HOME_SENSOR_PIN, INACTIVE);
+  setupSensors();
+  getSensorChanges();
+}
+
+void tearDown() {}
+
+// Fewer than SENSOR_FILTER_SAMPLES active samples, bouncing or not, doesn't change the state.
+void test_sensor_short_bounce_ignored() {
+  bounce(ACTIVE, SENSOR_FILTER_SAMPLES - 1);
+  for (uint16_t i = 0; i < SENSOR_FILTER_SAMPLES; i++) {
+    sample(INACTIVE);
+  }
+  for (uint16_t i = 0; i < SENSOR_FILTER_SAMPLES - 1; i++) {
+    sample(ACTIVE);
+  }
+  TEST_ASSERT_EQUAL(0, getSensorChanges());
+  TEST_ASSERT_EQUAL(INACTIVE, getHomeState());
+}
+
+// A bounce train longer than SENSOR_FILTER_SAMPLES never has enough samples more in one state than the other, so
+// the state doesn't change until the sensor settles, and then changes once after SENSOR_FILTER_SAMPLES.
+void test_sensor_long_bounce_settles() {
+  bounce(ACTIVE, 4 * SENSOR_FILTER_SAMPLES);
+  TEST_ASSERT_EQUAL(0, getSensorChanges());
+  TEST_ASSERT_EQUAL(INACTIVE, getHomeState());
+  for (uint16_t i = 0; i < SENSOR_FILTER_SAMPLES - 1; i++) {
+    sample(ACTIVE);
+  }
+  TEST_ASSERT_EQUAL(0, getSensorChanges());
+  sample(ACTIVE);
+  TEST_ASSERT_EQUAL(SENSOR_HOME, getSensorChanges());
+  TEST_ASSERT_EQUAL(ACTIVE, getHomeState());
+  // Bouncing on the way off the sensor again is also held until it settles.
+  bounce(INACTIVE, 4 * SENSOR_FILTER_SAMPLES + 1);
+  TEST_ASSERT_EQUAL(0, getSensorChanges());
+  TEST_ASSERT_EQUAL(ACTIVE, getHomeState());
+  for (uint16_t i = 0; i < SENSOR_FILTER_SAMPLES; i++) {
+    sample(INACTIVE);
+  }
+  TEST_ASSERT_EQUAL(SENSOR_HOME, getSensorChanges());
+  TEST_ASSERT_EQUAL(INACTIVE, getHomeState());
+}
+
+// A long train that is mostly active drifts the counter up, and changes the state exactly once.
+void test_sensor_long_uneven_bounce_changes_once() {
+  uint8_t changes = 0;
+  for (uint16_t i = 0; i < 3 * SENSOR_FILTER_SAMPLES; i++) {
+    sample(ACTIVE);
+    sample(ACTIVE);
+    sample(INACTIVE);
+    changes += getSensorChanges() ? 1 : 0;
+  }
+  TEST_ASSERT_EQUAL(1, changes);
+  TEST_ASSERT_EQUAL(ACTIVE, getHomeState());
+}
+
+#if !defined(DISABLE_SENSOR_INTERRUPTS)
+// The latch records the first edge once the sensor has been still for DEBOUNCE_DELAY, including exactly that long.
+void test_sensor_latch_debounce() {
+  long position;
+  simAdvance(DEBOUNCE_DELAY * 1000UL + 1000);
+  getHomeEdge(ACTIVE, position);
+  stepper.setCurrentPosition(100);
+  simSetInput(HOME_SENSOR_PIN, ACTIVE);
+  TEST_ASSERT_TRUE(getHomeEdge(ACTIVE, position));
+  TEST_ASSERT_EQUAL(100, position);
+  if (DEBOUNCE_DELAY > 0) {
+    // A bounce before DEBOUNCE_DELAY is ignored, and restarts the delay.
+    simAdvance((DEBOUNCE_DELAY - 1) * 1000UL);
+    stepper.setCurrentPosition(150);
+    simSetInput(HOME_SENSOR_PIN, INACTIVE);
+    TEST_ASSERT_FALSE(getHomeEdge(INACTIVE, position));
+  }
+  simAdvance(DEBOUNCE_DELAY * 1000UL);
+  stepper.setCurrentPosition(200);
+  simSetInput(HOME_SENSOR_PIN, DEBOUNCE_DELAY > 0 ? ACTIVE : INACTIVE);
+  TEST_ASSERT_TRUE(getHomeEdge(DEBOUNCE_DELAY > 0 ? ACTIVE : INACTIVE, position));
+  TEST_ASSERT_EQUAL(200, position);
+  stepper.setCurrentPosition(0);
+}
+#endif
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sensor_short_bounce_ignored);
+  RUN_TEST(test_sensor_long_bounce_settles);
+  RUN_TEST(test_sensor_long_uneven_bounce_changes_once);
+#if !defined(DISABLE_SENSOR_INTERRUPTS)
+  RUN_TEST(test_sensor_latch_debounce);
+#endif
+  return UNITY_END();
+}
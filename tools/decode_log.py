@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+#
+#  © 2026 Peter Cole
+#
+#  This file is part of EX-Turntable
+#
+#  This is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  It is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with EX-Turntable.  If not, see <https://www.gnu.org/licenses/>.
+
+"""Decode serial output from EX-Turntable built with LOG_COMPACT.
+
+Compact log lines are "#event value value...", with event being the position of the event in LogEvents.h.
+They are replaced by the event text and values as they would have been printed without LOG_COMPACT, and
+all other lines are passed through unchanged. Reads the files given, or standard input, eg.
+
+    pio device monitor | tools/decode_log.py
+    tools/decode_log.py capture.txt
+
+Use the LogEvents.h from the same version as the firmware, as the event numbers may change between versions.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+EVENT_PATTERN = re.compile(r'^\s*LOG_EVENT\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', re.MULTILINE)
+LINE_PATTERN = re.compile(r'^#(\d+)((?: -?\d+)*)$')
+
+
+def read_events(path):
+    """Return the (name, level, text) of each event in LogEvents.h, in order."""
+    with open(path, encoding='utf-8') as file:
+        source = file.read()
+    return [(name, level, bytes(text, 'utf-8').decode('unicode_escape'))
+            for name, level, text in EVENT_PATTERN.findall(source)]
+
+
+def decode_line(line, events):
+    """Return the text for a compact log line, or the line unchanged if it isn't one."""
+    match = LINE_PATTERN.match(line)
+    if not match:
+        return line
+    event = int(match.group(1))
+    values = match.group(2).split()
+    if event >= len(events):
+        return 'UNKNOWN EVENT {}: {}'.format(event, '|'.join(values))
+    return events[event][2] + '|'.join(values)
+
+
+def main():
+    default_events = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'LogEvents.h')
+    parser = argparse.ArgumentParser(description='Decode EX-Turntable LOG_COMPACT serial output.')
+    parser.add_argument('files', nargs='*', help='captured output to decode, standard input if none')
+    parser.add_argument('-e', '--events', default=default_events, help='path to LogEvents.h')
+    args = parser.parse_args()
+
+    events = read_events(args.events)
+    if not events:
+        sys.exit('No events found in ' + args.events)
+    inputs = [open(name, encoding='utf-8', errors='replace') for name in args.files] or [sys.stdin]
+    for stream in inputs:
+        for line in stream:
+            print(decode_line(line.rstrip('\r\n'), events), flush=True)
+
+
+if __name__ == '__main__':
+    main()
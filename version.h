@@ -6,7 +6,37 @@
 // 0.8.0:
 //  - add defines for RT_EX_Turntable single board
 //  - add ESP32 compile
-//  - 
+//  - Add optional fixed point acceleration ramp engine via STEPPER_RAMP_ENGINE FIXED_RAMP
+//  - Add optional timer interrupt driven stepping via STEPPER_TIMER_INTERRUPT
+//  - Add optional precomputed acceleration ramp table via STEPPER_RAMP_ENGINE TABLE_RAMP
+//  - Add <B> serial command to benchmark the acceleration ramp engines
+//  - Add optional jerk limited S-curve acceleration via STEPPER_RAMP_ENGINE SCURVE_RAMP
+//  - Write stepper outputs directly to the port registers on AVR and ESP32 for higher step rates
+//  - Add optional non blocking step pulses for step/direction drivers via STEPPER_NONBLOCKING_PULSE
+//  - Standard stepper definitions select the driver step function at compile time
+//  - Add optional drift free step scheduling via STEPPER_MAX_CATCH_UP
+//  - Add <L> serial command to display step lateness
+//  - Add PlatformIO native environment to run the firmware on a host against simulated hardware
+//  - Queue I2C commands in the receive interrupt and execute them from the main loop
+//  - Add <Q> serial command to display I2C command queue statistics
+//  - Add opt in extended I2C status frame with state, flags, errors, change counter and positions
+//  - Add 32 bit I2C move command for full step positions without the gearing factor
+//  - Add I2C register interface for status, position, speed, acceleration, phase and outputs with burst reads and writes
+//  - Add I2C batch command to send several activities and a move in one transmission
+//  - Add I2C framed commands with a sequence number and CRC-8 to reject corrupt frames and ignore retries
+//  - Add <P> serial command and I2C command to store and move to indexed positions held in EEPROM
+//  - Add optional DCC accessory decoder on D2 via DCC_ACCESSORY_ADDRESS
+//  - Add optional open drain ATTENTION_PIN to signal moves completing, homing failing and calibration ending
+//  - Remove the 32767 step limit from the <M> serial command, which now takes full step positions
+//  - Parse serial commands a byte at a time, replying <X> to malformed commands instead of truncating them
+//  - Add <S> and <N> serial commands for machine readable status and counters
+//  - Buffer serial output during operation so printing never holds up the stepper
+//  - Add <W> serial command to stream CSV telemetry of position, speed, phase, sensors and loop timing
+//  - Add LOG_LEVEL to leave messages out of the build, and LOG_COMPACT numbered events with tools/decode_log.py
+//  - Record the step at each home and limit sensor edge by interrupt, so homing and calibration don't depend on loop timing
+//  - Sample the home and limit sensors at a fixed rate with a counter based debounce that also rejects glitches in turntable mode
+//  - Add optional two speed homing via HOMING_APPROACH_SPEED, and report homing time and drift
+//  - Add optional PERSIST_POSITION to save the position when stopped and start up without homing
 
 
 // 0.7.0: